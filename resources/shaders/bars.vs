@@ -0,0 +1,48 @@
+#version 330 core
+
+// Builds the quads of one layer of the bars of a spectrum, one instance per bar. Every layer
+// is a single instanced draw call, see fft_render_spectrum().
+
+// Corner of the quad, (0, 0) is the top left
+layout(location = 0) in vec2 corner;
+// Per bar: the smoothed and the smeared value of the band, both within 0..1
+layout(location = 1) in vec2 bar;
+layout(location = 2) in vec4 color;
+
+uniform mat4 mvp;
+uniform vec4 boundary;   // x, y, width, height
+uniform float cellWidth;
+uniform int layer;       // Bar_Layer: 0 lines, 1 smears, 2 circles
+uniform float glowScale; // Of the smears and the circles, they shrink when the bloom does the glow
+
+// Output vertex attributes (to fragment shader)
+out vec2 fragTexCoord;
+out vec4 fragColor;
+
+void main() {
+    float x = boundary.x + (float(gl_InstanceID) + 0.5)*cellWidth;
+    float bottom = boundary.y + boundary.w;
+    float top = bottom - boundary.w*2.0/3.0*bar.x;
+
+    vec2 position;
+    fragTexCoord = corner;
+    if (layer == 0) {
+        // From the top of the bar down to the bottom of the boundary
+        float thick = cellWidth/3.0*sqrt(bar.x);
+        position = vec2(x + (corner.x - 0.5)*thick, mix(top, bottom, corner.y));
+    } else if (layer == 1) {
+        // Between the smeared and the smoothed value. A falling bar leaves the top half of the
+        // circle behind, a rising one the bottom half.
+        float smear = bottom - boundary.w*2.0/3.0*bar.y;
+        float radius = cellWidth*3.0*glowScale*sqrt(bar.x);
+        position = vec2(x + (corner.x - 0.5)*radius, mix(min(smear, top), max(smear, top), corner.y));
+        fragTexCoord.y = 0.5*corner.y + (top >= smear ? 0.0 : 0.5);
+    } else {
+        // Centered on the top of the bar
+        float radius = cellWidth*6.0*glowScale*sqrt(bar.x);
+        position = vec2(x, top) + (2.0*corner - 1.0)*radius;
+    }
+
+    fragColor = color;
+    gl_Position = mvp*vec4(position, 0.0, 1.0);
+}
@@ -0,0 +1,31 @@
+#version 330 core
+
+// One step down the chain of fft_render_bloom(): the average of 5 bilinear taps around the
+// texel, weighted towards the center. The dual filter of Marius Bjørge, "Bandwidth-Efficient
+// Rendering", SIGGRAPH 2015.
+
+// Input vertex attributes (from vertex shader)
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform vec2 halfPixel;  // Half of a texel of the target
+uniform float threshold; // Only the colors brighter than this glow, 0 past the first step
+
+// Output fragment color
+out vec4 finalColor;
+
+void main() {
+    vec2 uv = fragTexCoord;
+    vec3 sum = texture(texture0, uv).rgb*4.0;
+    sum += texture(texture0, uv - halfPixel).rgb;
+    sum += texture(texture0, uv + halfPixel).rgb;
+    sum += texture(texture0, uv + vec2(halfPixel.x, -halfPixel.y)).rgb;
+    sum += texture(texture0, uv - vec2(halfPixel.x, -halfPixel.y)).rgb;
+    vec3 color = sum/8.0;
+
+    // Keeps the hue of the color and takes the threshold off its brightness
+    float brightness = max(color.r, max(color.g, color.b));
+    color *= max(brightness - threshold, 0.0)/max(brightness, 1e-4);
+    finalColor = vec4(color, 1.0);
+}
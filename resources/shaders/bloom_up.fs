@@ -0,0 +1,30 @@
+#version 330 core
+
+// One step up the chain of fft_render_bloom(), a tent of 8 bilinear taps. Drawn with additive
+// blending, so every level collects the blur of all of the levels below it. The counterpart of
+// bloom_down.fs.
+
+// Input vertex attributes (from vertex shader)
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform vec2 halfPixel;  // Half of a texel of the target
+uniform float intensity;
+
+// Output fragment color
+out vec4 finalColor;
+
+void main() {
+    vec2 uv = fragTexCoord;
+    vec3 sum = vec3(0.0);
+    sum += texture(texture0, uv + vec2(-halfPixel.x*2.0, 0.0)).rgb;
+    sum += texture(texture0, uv + vec2(halfPixel.x*2.0, 0.0)).rgb;
+    sum += texture(texture0, uv + vec2(0.0, -halfPixel.y*2.0)).rgb;
+    sum += texture(texture0, uv + vec2(0.0, halfPixel.y*2.0)).rgb;
+    sum += texture(texture0, uv + vec2(-halfPixel.x, halfPixel.y)).rgb*2.0;
+    sum += texture(texture0, uv + vec2(halfPixel.x, halfPixel.y)).rgb*2.0;
+    sum += texture(texture0, uv + vec2(halfPixel.x, -halfPixel.y)).rgb*2.0;
+    sum += texture(texture0, uv + vec2(-halfPixel.x, -halfPixel.y)).rgb*2.0;
+    finalColor = vec4(sum/12.0*intensity, 1.0);
+}
@@ -0,0 +1,97 @@
+#version 330 core
+
+// Draws the bars, the smears and the circles of a whole spectrum in a single pass, see
+// fft_render_spectrum_texture(). Every fragment works out which bars can reach it and blends
+// their layers in the same order as the instanced renderer draws them, so the two look the same.
+
+// Input vertex attributes (from vertex shader)
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D bands;   // Row 0 the smoothed values, row 1 the smeared ones
+uniform int count;         // Amount of bands in the rows, the texture may be wider
+uniform vec4 area;         // x, y, width, height of the quad that is drawn
+uniform vec4 boundary;     // x, y, width, height of the spectrum itself
+uniform sampler2D palette; // The whole palette from 0 on the left to 1 on the right
+uniform float paletteFrom;
+uniform float paletteRange;
+uniform float glowScale;   // Of the smears and the circles, they shrink when the bloom does the glow
+
+// Output fragment color
+out vec4 finalColor;
+
+// The color of the bar i. The first and the last texel of the palette are exactly at 0 and 1.
+vec4 barColor(int i) {
+    float t = fract(paletteFrom + paletteRange*float(i)/float(count));
+    float size = float(textureSize(palette, 0).x);
+    return texture(palette, vec2((t*(size - 1.0) + 0.5)/size, 0.5));
+}
+
+// The same as circle.fs over the quad with the texture coordinates uv
+vec4 circle(vec2 uv, vec4 color, float radius, float power) {
+    float distance = length(uv - vec2(0.5));
+    if (distance > 0.5) return vec4(0.0);
+    float s = distance - radius;
+    if (s <= 0.0) return color*1.5;
+    float t = 1.0 - s/(0.5 - radius);
+    return mix(vec4(color.xyz, 0), color*1.5, pow(t, power));
+}
+
+// Blends c over the premultiplied acc like the alpha blending of raylib would, including
+// the clamping of the framebuffer
+void over(inout vec4 acc, vec4 c) {
+    c = clamp(c, 0.0, 1.0);
+    acc = vec4(c.rgb*c.a, c.a) + acc*(1.0 - c.a);
+}
+
+bool inside(vec2 pos, vec2 from, vec2 to) {
+    return all(greaterThanEqual(pos, from)) && all(lessThan(pos, to));
+}
+
+void main() {
+    vec2 pos = area.xy + fragTexCoord*area.zw;
+    float cellWidth = boundary.z/float(count);
+    float bottom = boundary.y + boundary.w;
+    float height = boundary.w*2.0/3.0;
+    int column = int(floor((pos.x - boundary.x)/cellWidth));
+    vec4 acc = vec4(0.0);
+
+    // Lines. Never wider than a third of the cell, so only the bar of the column gets here.
+    if (0 <= column && column < count) {
+        float t = texelFetch(bands, ivec2(column, 0), 0).r;
+        float x = boundary.x + (float(column) + 0.5)*cellWidth;
+        float thick = cellWidth/3.0*sqrt(t);
+        if (inside(pos, vec2(x - thick/2.0, bottom - height*t), vec2(x + thick/2.0, bottom))) {
+            over(acc, barColor(column));
+        }
+    }
+
+    // Smears, up to 1.5 cells on either side
+    for (int i = max(column - 2, 0); i <= min(column + 2, count - 1); ++i) {
+        float t = texelFetch(bands, ivec2(i, 0), 0).r;
+        float smear = bottom - height*texelFetch(bands, ivec2(i, 1), 0).r;
+        float top = bottom - height*t;
+        float x = boundary.x + (float(i) + 0.5)*cellWidth;
+        float radius = cellWidth*3.0*glowScale*sqrt(t);
+        vec2 from = vec2(x - radius/2.0, min(smear, top));
+        vec2 to = vec2(x + radius/2.0, max(smear, top));
+        if (inside(pos, from, to)) {
+            vec2 uv = (pos - from)/(to - from);
+            uv.y = 0.5*uv.y + (top >= smear ? 0.0 : 0.5);
+            over(acc, circle(uv, barColor(i), 0.3, 3.0));
+        }
+    }
+
+    // Circles, up to 6 cells on either side
+    for (int i = max(column - 6, 0); i <= min(column + 6, count - 1); ++i) {
+        float t = texelFetch(bands, ivec2(i, 0), 0).r;
+        vec2 center = vec2(boundary.x + (float(i) + 0.5)*cellWidth, bottom - height*t);
+        float radius = cellWidth*6.0*glowScale*sqrt(t);
+        if (inside(pos, center - radius, center + radius)) {
+            vec2 uv = (pos - (center - radius))/(2.0*radius);
+            over(acc, circle(uv, barColor(i), 0.07, 5.0));
+        }
+    }
+
+    finalColor = acc;
+}
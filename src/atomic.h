@@ -0,0 +1,72 @@
+#ifndef ATOMIC_H_
+#define ATOMIC_H_
+
+// Bare minimum of atomics needed to pass data between the audio thread and the rest
+// of Musializer without locks.
+//
+// NOTE: we don't use <stdatomic.h> because MSVC only supports it behind experimental flags.
+// On MSVC we only target x86_64 where plain aligned loads/stores already have the
+// acquire/release semantics, so a compiler barrier is enough.
+
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#   include <intrin.h>
+static inline uint64_t atomic_u64_load(volatile uint64_t *x)
+{
+    uint64_t v = *x;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static inline void atomic_u64_store(volatile uint64_t *x, uint64_t v)
+{
+    _ReadWriteBarrier();
+    *x = v;
+}
+
+static inline uint32_t atomic_u32_load(volatile uint32_t *x)
+{
+    uint32_t v = *x;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static inline void atomic_u32_store(volatile uint32_t *x, uint32_t v)
+{
+    _ReadWriteBarrier();
+    *x = v;
+}
+
+static inline uint32_t atomic_u32_exchange(volatile uint32_t *x, uint32_t v)
+{
+    return (uint32_t)_InterlockedExchange((volatile long*)x, (long)v);
+}
+#else
+static inline uint64_t atomic_u64_load(volatile uint64_t *x)
+{
+    return __atomic_load_n(x, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_u64_store(volatile uint64_t *x, uint64_t v)
+{
+    __atomic_store_n(x, v, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomic_u32_load(volatile uint32_t *x)
+{
+    return __atomic_load_n(x, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_u32_store(volatile uint32_t *x, uint32_t v)
+{
+    __atomic_store_n(x, v, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomic_u32_exchange(volatile uint32_t *x, uint32_t v)
+{
+    return __atomic_exchange_n(x, v, __ATOMIC_ACQ_REL);
+}
+#endif // _MSC_VER
+
+#endif // ATOMIC_H_
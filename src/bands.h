@@ -0,0 +1,267 @@
+#ifndef BANDS_H_
+#define BANDS_H_
+
+// Mapping of FFT bins onto the bands (bars) of the visualizer.
+//
+// Every band is a contiguous range of bins. The ranges are computed once per FFT size, sample
+// rate and scale in bands_init(), so the per-frame work in bands_aggregate() is just a max or
+// a mean over each range. The bands cover the bins from 1 (DC is skipped) up to fft_size/2
+// without gaps. Bands that would be narrower than a single bin are merged with their
+// neighbours, so the amount of bands depends on the FFT size.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    // Every band is 6% wider than the previous one, counted in bins. The classic Musializer look.
+    BANDS_SCALE_LOG,
+    BANDS_SCALE_MEL,
+    BANDS_SCALE_BARK,
+    // 1/N of an octave per band
+    BANDS_SCALE_OCTAVE,
+    COUNT_BANDS_SCALES,
+} Bands_Scale;
+
+typedef enum {
+    BANDS_AGGREGATE_MAX,
+    // Mean power of the band, i.e. the square of the RMS of the magnitudes
+    BANDS_AGGREGATE_RMS,
+    COUNT_BANDS_AGGREGATES,
+} Bands_Aggregate;
+
+#define BANDS_MEL_COUNT 128
+#define BANDS_BARK_PER_BARK 4
+#define BANDS_MIN_FREQUENCY 20.0f
+
+typedef struct {
+    size_t fft_size;
+    float sample_rate;
+    Bands_Scale scale;
+    size_t octave_divisions; // N of the 1/N-octave scale
+    size_t count;            // Amount of bands
+    uint32_t *start;         // First bin of every band
+    uint32_t *end;           // One past the last bin of every band
+    float *center;           // Center frequency of every band in Hz
+} Bands;
+
+const char *bands_scale_name(Bands_Scale scale);
+const char *bands_aggregate_name(Bands_Aggregate aggregate);
+
+bool bands_init(Bands *bands, size_t fft_size, float sample_rate, Bands_Scale scale, size_t octave_divisions);
+void bands_free(Bands *bands);
+// `power` is the linear power of every bin (at least fft_size/2 entries). Writes one value
+// per band into `out`.
+void bands_aggregate(const Bands *bands, const float power[], float out[], Bands_Aggregate aggregate);
+
+#endif // BANDS_H_
+
+// NOTE: sdft.h includes bands.h too, so the implementation must survive being included more
+// than once
+#if defined(BANDS_IMPLEMENTATION) && !defined(BANDS_IMPLEMENTATION_INCLUDED_)
+#define BANDS_IMPLEMENTATION_INCLUDED_
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define BANDS_SSE2
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   define BANDS_NEON
+#   include <arm_neon.h>
+#endif
+
+const char *bands_scale_name(Bands_Scale scale)
+{
+    switch (scale) {
+    case BANDS_SCALE_LOG:    return "Log";
+    case BANDS_SCALE_MEL:    return "Mel";
+    case BANDS_SCALE_BARK:   return "Bark";
+    case BANDS_SCALE_OCTAVE: return "Octave";
+    default:                 return "Unknown";
+    }
+}
+
+const char *bands_aggregate_name(Bands_Aggregate aggregate)
+{
+    switch (aggregate) {
+    case BANDS_AGGREGATE_MAX: return "Max";
+    case BANDS_AGGREGATE_RMS: return "RMS";
+    default:                  return "Unknown";
+    }
+}
+
+// Frequency in Hz to the units of the scale and back
+static float bands_to_scale(Bands_Scale scale, float f)
+{
+    switch (scale) {
+    case BANDS_SCALE_MEL:    return 2595.0f*log10f(1.0f + f/700.0f);
+    // Traunmueller's approximation
+    case BANDS_SCALE_BARK:   return 26.81f*f/(1960.0f + f) - 0.53f;
+    case BANDS_SCALE_LOG:
+    case BANDS_SCALE_OCTAVE: return log2f(f);
+    default: assert(0 && "unreachable"); return 0.0f;
+    }
+}
+
+static float bands_from_scale(Bands_Scale scale, float u)
+{
+    switch (scale) {
+    case BANDS_SCALE_MEL:    return 700.0f*(powf(10.0f, u/2595.0f) - 1.0f);
+    case BANDS_SCALE_BARK:   return 1960.0f*(u + 0.53f)/(26.28f - u);
+    case BANDS_SCALE_LOG:
+    case BANDS_SCALE_OCTAVE: return exp2f(u);
+    default: assert(0 && "unreachable"); return 0.0f;
+    }
+}
+
+static void bands_push(Bands *bands, size_t start, size_t end)
+{
+    float bin = bands->sample_rate/bands->fft_size;
+    float u0 = bands_to_scale(bands->scale, start*bin);
+    float u1 = bands_to_scale(bands->scale, end*bin);
+    bands->start[bands->count] = start;
+    bands->end[bands->count] = end;
+    bands->center[bands->count] = bands_from_scale(bands->scale, (u0 + u1)/2);
+    bands->count += 1;
+}
+
+bool bands_init(Bands *bands, size_t fft_size, float sample_rate, Bands_Scale scale, size_t octave_divisions)
+{
+    assert(fft_size >= 4);
+    assert(octave_divisions > 0);
+    memset(bands, 0, sizeof(*bands));
+    bands->fft_size = fft_size;
+    bands->sample_rate = sample_rate;
+    bands->scale = scale;
+    bands->octave_divisions = octave_divisions;
+
+    // Every band has at least one bin of its own, so there are less than fft_size/2 of them
+    size_t half = fft_size/2;
+    bands->start = malloc(half*sizeof(*bands->start));
+    bands->end = malloc(half*sizeof(*bands->end));
+    bands->center = malloc(half*sizeof(*bands->center));
+    if (bands->start == NULL || bands->end == NULL || bands->center == NULL) {
+        bands_free(bands);
+        return false;
+    }
+
+    if (scale == BANDS_SCALE_LOG) {
+        // NOTE: this is exactly the layout the old "squash into the logarithmic scale" loop of
+        // fft_analyze() produced, so the bars look the same as they always did
+        float step = 1.06;
+        for (float f = 1.0f; (size_t)f < half; f = ceilf(f*step)) {
+            size_t end = (size_t)ceilf(f*step);
+            if (end > half) end = half;
+            bands_push(bands, (size_t)f, end);
+        }
+        return true;
+    }
+
+    float bin = sample_rate/fft_size;
+    float f_lo = BANDS_MIN_FREQUENCY;
+    if (f_lo < bin) f_lo = bin;
+    float f_hi = half*bin;
+    float u_lo = bands_to_scale(scale, f_lo);
+    float u_hi = bands_to_scale(scale, f_hi);
+
+    size_t n = 0;
+    switch (scale) {
+    case BANDS_SCALE_MEL:    n = BANDS_MEL_COUNT; break;
+    case BANDS_SCALE_BARK:   n = (size_t)ceilf((u_hi - u_lo)*BANDS_BARK_PER_BARK); break;
+    case BANDS_SCALE_OCTAVE: n = (size_t)ceilf((u_hi - u_lo)*octave_divisions); break;
+    default: assert(0 && "unreachable");
+    }
+    if (n == 0) n = 1;
+
+    // Everything below the first edge goes into the first band
+    size_t prev = 1;
+    for (size_t i = 1; i <= n; ++i) {
+        float f = bands_from_scale(scale, u_lo + (u_hi - u_lo)*i/n);
+        size_t end = i == n ? half : (size_t)floorf(f/bin + 0.5f);
+        if (end > half) end = half;
+        if (end <= prev) continue; // Narrower than a bin, merge it with the next one
+        bands_push(bands, prev, end);
+        prev = end;
+    }
+    return true;
+}
+
+void bands_free(Bands *bands)
+{
+    free(bands->start);
+    free(bands->end);
+    free(bands->center);
+    memset(bands, 0, sizeof(*bands));
+}
+
+static inline float bands_max(const float *x, size_t n)
+{
+    float a = x[0];
+    size_t i = 1;
+#if defined(BANDS_SSE2)
+    if (n >= 8) {
+        __m128 m = _mm_loadu_ps(x);
+        for (i = 4; i + 4 <= n; i += 4) m = _mm_max_ps(m, _mm_loadu_ps(x + i));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+        m = _mm_max_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        a = _mm_cvtss_f32(m);
+    }
+#elif defined(BANDS_NEON)
+    if (n >= 8) {
+        float32x4_t m = vld1q_f32(x);
+        for (i = 4; i + 4 <= n; i += 4) m = vmaxq_f32(m, vld1q_f32(x + i));
+        a = vmaxvq_f32(m);
+    }
+#endif
+    for (; i < n; ++i) {
+        if (x[i] > a) a = x[i];
+    }
+    return a;
+}
+
+static inline float bands_sum(const float *x, size_t n)
+{
+    float a = 0.0f;
+    size_t i = 0;
+#if defined(BANDS_SSE2)
+    if (n >= 8) {
+        __m128 s = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) s = _mm_add_ps(s, _mm_loadu_ps(x + i));
+        s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1, 0, 3, 2)));
+        s = _mm_add_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+        a = _mm_cvtss_f32(s);
+    }
+#elif defined(BANDS_NEON)
+    if (n >= 8) {
+        float32x4_t s = vdupq_n_f32(0.0f);
+        for (; i + 4 <= n; i += 4) s = vaddq_f32(s, vld1q_f32(x + i));
+        a = vaddvq_f32(s);
+    }
+#endif
+    for (; i < n; ++i) a += x[i];
+    return a;
+}
+
+void bands_aggregate(const Bands *bands, const float power[], float out[], Bands_Aggregate aggregate)
+{
+    switch (aggregate) {
+    case BANDS_AGGREGATE_MAX:
+        for (size_t i = 0; i < bands->count; ++i) {
+            out[i] = bands_max(power + bands->start[i], bands->end[i] - bands->start[i]);
+        }
+        break;
+    case BANDS_AGGREGATE_RMS:
+        for (size_t i = 0; i < bands->count; ++i) {
+            size_t n = bands->end[i] - bands->start[i];
+            out[i] = bands_sum(power + bands->start[i], n)/n;
+        }
+        break;
+    default: assert(0 && "unreachable");
+    }
+}
+
+#endif // BANDS_IMPLEMENTATION
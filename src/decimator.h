@@ -0,0 +1,140 @@
+#ifndef DECIMATOR_H_
+#define DECIMATOR_H_
+
+// Integer-factor decimation of a stream of samples in front of the analyzer.
+//
+// A 96kHz or 192kHz source puts most of the bins of the analysis above anything audible, and
+// the same FFT size covers a much shorter stretch of time. Dividing the sample rate by 2 or 4
+// first brings it back to the usual rates, so the layout of the bands and the cost of the
+// analysis per second of audio no longer depend on the source.
+//
+// The anti-aliasing filter is a windowed sinc of DECIMATOR_TAPS_PER_PHASE*factor taps. It is
+// only ever evaluated for the samples that are kept, which is all the polyphase decomposition
+// of a decimator boils down to: every output costs taps multiply-adds, every input taps/factor.
+//
+// Everything lives in the struct itself, so switching the factor never allocates and can be
+// done right in the audio callback.
+
+#include <stddef.h>
+
+#define DECIMATOR_FACTOR_MAX 4
+#define DECIMATOR_TAPS_PER_PHASE 32
+#define DECIMATOR_TAPS_MAX (DECIMATOR_FACTOR_MAX*DECIMATOR_TAPS_PER_PHASE)
+#define DECIMATOR_BLOCK 256
+
+typedef struct {
+    size_t factor;
+    size_t taps;
+    float coeffs[DECIMATOR_TAPS_MAX];             // Oldest sample first
+    float line[DECIMATOR_TAPS_MAX + DECIMATOR_BLOCK]; // The latest taps - 1 inputs and the new block
+    size_t next;                                  // Index in line of the next input to keep
+} Decimator;
+
+// The smallest power of two that brings the sample rate down to at most `max_rate`, capped
+// at DECIMATOR_FACTOR_MAX
+size_t decimator_factor(float sample_rate, float max_rate);
+// `factor` is at most DECIMATOR_FACTOR_MAX. A factor of 1 passes the samples through.
+void decimator_init(Decimator *d, size_t factor);
+// Forgets the history. Starts over from silence.
+void decimator_reset(Decimator *d);
+// Filters `count` samples and writes every factor-th of them into `out`, which may be the same
+// as `in`. Returns the amount of samples written, which is about count/factor depending on
+// where the previous call left off.
+size_t decimator_process(Decimator *d, const float in[], size_t count, float out[]);
+
+#endif // DECIMATOR_H_
+
+#ifdef DECIMATOR_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+// The passband ends this far into the new Nyquist frequency. The rest is the transition band,
+// where a little aliasing folds back onto the very top of the spectrum.
+#define DECIMATOR_PASSBAND 0.9
+#define DECIMATOR_PI 3.14159265358979323846
+
+size_t decimator_factor(float sample_rate, float max_rate)
+{
+    size_t factor = 1;
+    while (factor < DECIMATOR_FACTOR_MAX && sample_rate/factor > max_rate) factor *= 2;
+    return factor;
+}
+
+void decimator_init(Decimator *d, size_t factor)
+{
+    assert(0 < factor && factor <= DECIMATOR_FACTOR_MAX);
+    d->factor = factor;
+    d->taps = factor == 1 ? 1 : DECIMATOR_TAPS_PER_PHASE*factor;
+
+    if (factor == 1) {
+        d->coeffs[0] = 1.0f;
+    } else {
+        // Blackman windowed sinc, normalized to unity gain at DC
+        double cutoff = 0.5*DECIMATOR_PASSBAND/factor;
+        double center = 0.5*(d->taps - 1);
+        double sum = 0.0;
+        for (size_t i = 0; i < d->taps; ++i) {
+            double x = i - center;
+            double sinc = x == 0.0 ? 2.0*cutoff : sin(2.0*DECIMATOR_PI*cutoff*x)/(DECIMATOR_PI*x);
+            double t = (double)i/(d->taps - 1);
+            double window = 0.42 - 0.5*cos(2.0*DECIMATOR_PI*t) + 0.08*cos(4.0*DECIMATOR_PI*t);
+            d->coeffs[i] = sinc*window;
+            sum += d->coeffs[i];
+        }
+        for (size_t i = 0; i < d->taps; ++i) d->coeffs[i] /= sum;
+    }
+    decimator_reset(d);
+}
+
+void decimator_reset(Decimator *d)
+{
+    memset(d->line, 0, sizeof(d->line));
+    d->next = d->taps - 1;
+}
+
+static float decimator_dot(const float *x, const float *h, size_t n)
+{
+    // Separate accumulators so the additions don't wait on each other
+    float acc[4] = {0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc[0] += x[i + 0]*h[i + 0];
+        acc[1] += x[i + 1]*h[i + 1];
+        acc[2] += x[i + 2]*h[i + 2];
+        acc[3] += x[i + 3]*h[i + 3];
+    }
+    for (; i < n; ++i) acc[0] += x[i]*h[i];
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+size_t decimator_process(Decimator *d, const float in[], size_t count, float out[])
+{
+    if (d->factor == 1) {
+        memmove(out, in, count*sizeof(*out));
+        return count;
+    }
+
+    // NOTE: out may be the same as in. Every block is copied into the line before any of its
+    // outputs are written, and there are fewer outputs than inputs, so the writes never catch
+    // up with the reads.
+    size_t keep = d->taps - 1;
+    size_t produced = 0;
+    while (count > 0) {
+        size_t n = count < DECIMATOR_BLOCK ? count : DECIMATOR_BLOCK;
+        memcpy(d->line + keep, in, n*sizeof(*in));
+        size_t end = keep + n;
+        size_t i = d->next;
+        for (; i < end; i += d->factor) {
+            out[produced++] = decimator_dot(d->line + i + 1 - d->taps, d->coeffs, d->taps);
+        }
+        memmove(d->line, d->line + n, keep*sizeof(*d->line));
+        d->next = i - n;
+        in += n;
+        count -= n;
+    }
+    return produced;
+}
+
+#endif // DECIMATOR_IMPLEMENTATION
@@ -123,6 +123,16 @@ bool ffmpeg_end_rendering(FFMPEG *ffmpeg, bool cancel) {
     assert(0 && "Unreachable");
 }
 
+bool ffmpeg_send_frame(FFMPEG *ffmpeg, void *data, size_t width, size_t height) {
+    for (size_t y = 0; y < height; ++y) {
+        if (write(ffmpeg->pipe, (uint32_t*)data + y * width, sizeof(uint32_t) * width) < 0) {
+            TraceLog(LOG_ERROR, "FFMPEG: failed to write into ffmpeg pipe: %s", strerror(errno));
+            return false;
+        };
+    }
+    return true;
+}
+
 bool ffmpeg_send_frame_flipped(FFMPEG *ffmpeg, void *data, size_t width, size_t height) {
     for (size_t y = height; y > 0; --y) {
         if (write(ffmpeg->pipe, (uint32_t*)data + (y - 1) * width, sizeof(uint32_t) * width) < 0) {
@@ -0,0 +1,1034 @@
+#ifndef FFT_H_
+#define FFT_H_
+
+// Plan-based iterative radix-2 FFT.
+//
+// Everything that depends only on the size of the transform (the bit-reversal permutation
+// and the twiddle factors) is computed once in fft_plan_init(). fft_execute() then only does
+// the butterflies. The twiddles of each stage are stored next to each other so the inner
+// loop walks them with unit stride.
+//
+// Since Musializer only ever analyzes real signals there is also FFT_Real_Plan that packs
+// n real samples into n/2 complex ones, runs the half-sized FFT on them and untangles the
+// result into the n/2 + 1 non-redundant bins. That is roughly half of the work and half of
+// the memory of the full complex transform.
+//
+// FFT_Batch transforms several streams of the same size at once. It keeps the streams
+// interleaved sample by sample with the real and imaginary parts apart, so every butterfly
+// applies one twiddle to all of the streams and the SIMD lanes go across the streams instead
+// of along a single one. No lane ever has to be shuffled and even the first stages, which the
+// single stream kernels leave to scalar code, run at the full width.
+//
+// The hot loops (butterflies, window multiply, squared magnitude and the recurrence of the
+// sliding DFT of sdft.h) come in several flavors: scalar, SSE2, AVX2 and NEON. fft_kernels_best() picks the fastest one the
+// current CPU supports and fft_kernels_select() switches to it. Until somebody calls
+// fft_kernels_select() the scalar kernels are used.
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Microsoft could not update their parser OMEGALUL
+// https://learn.microsoft.com/en-us/cpp/c-runtime-library/complex-math-support?view=msvc-170#types-used-in-complex-math
+#ifdef _MSC_VER
+#   define Float_Complex _Fcomplex
+#   define cfromreal(re) _FCbuild(re, 0)
+#   define cfromimag(im) _FCbuild(0, im)
+#   define cbuild(re, im) _FCbuild(re, im)
+#   define mulcc _FCmulcc
+#   define addcc(a, b) _FCbuild(crealf(a) + crealf(b), cimagf(a) + cimagf(b))
+#   define subcc(a, b) _FCbuild(crealf(a) - crealf(b), cimagf(a) - cimagf(b))
+#else
+#   define Float_Complex float complex
+#   define cfromreal(re) (re)
+#   define cfromimag(im) ((im)*I)
+#   define cbuild(re, im) ((re) + (im)*I)
+#   define mulcc(a, b) ((a)*(b))
+#   define addcc(a, b) ((a)+(b))
+#   define subcc(a, b) ((a)-(b))
+#endif // _MSC_VER
+
+typedef struct {
+    size_t n;                // Size of the transform. Always a power of two.
+    uint32_t *rev;           // n entries. Bit-reversal permutation of the input.
+    Float_Complex *twiddles; // n - 1 entries. The stage with half size h starts at h - 1.
+} FFT_Plan;
+
+typedef struct {
+    size_t n;                // Amount of real samples. Always a power of two and at least 4.
+    FFT_Plan half;           // Complex plan of size n/2
+    Float_Complex *twiddles; // n/4 + 1 entries of exp(-2*pi*i*k/n)
+} FFT_Real_Plan;
+
+bool fft_plan_init(FFT_Plan *plan, size_t n);
+void fft_plan_free(FFT_Plan *plan);
+// Transforms n real samples from `in` into n complex bins in `out`
+void fft_execute(const FFT_Plan *plan, const float in[], Float_Complex out[]);
+// Transforms n complex samples from `in` into n complex bins in `out`
+void fft_execute_complex(const FFT_Plan *plan, const Float_Complex in[], Float_Complex out[]);
+
+bool fft_real_plan_init(FFT_Real_Plan *plan, size_t n);
+void fft_real_plan_free(FFT_Real_Plan *plan);
+// Transforms n real samples from `in` into n/2 + 1 complex bins in `out`
+void fft_real_execute(const FFT_Real_Plan *plan, const float in[], Float_Complex out[]);
+
+// The kernels process the streams in groups of this many
+#define FFT_BATCH_LANES 4
+
+typedef struct {
+    FFT_Real_Plan plan; // Only the permutation and the twiddles are used
+    size_t streams;     // Most streams a single execution can take
+    size_t stride;      // streams rounded up to FFT_BATCH_LANES
+    float *re;          // n/2*stride entries. The streams of a sample are next to each other.
+    float *im;
+} FFT_Batch;
+
+bool fft_batch_init(FFT_Batch *batch, size_t n, size_t streams);
+void fft_batch_free(FFT_Batch *batch);
+// Same as fft_real_execute() on in[s] and out[s] for every s below `count`, which is at most
+// batch->streams
+void fft_batch_execute(FFT_Batch *batch, const float *const in[], Float_Complex *const out[], size_t count);
+
+typedef enum {
+    FFT_KERNELS_SCALAR,
+    FFT_KERNELS_SSE2,
+    FFT_KERNELS_AVX2,
+    FFT_KERNELS_NEON,
+    COUNT_FFT_KERNELS,
+} FFT_Kernels_Kind;
+
+const char *fft_kernels_name(FFT_Kernels_Kind kind);
+// The fastest kernels supported by both this build and the CPU we are running on
+FFT_Kernels_Kind fft_kernels_best(void);
+// Returns false and keeps the current kernels if `kind` is not supported
+bool fft_kernels_select(FFT_Kernels_Kind kind);
+FFT_Kernels_Kind fft_kernels_current(void);
+
+// out[i] = in[i]*window[i]
+void fft_window(const float in[], const float window[], float out[], size_t n);
+// out[i] = |in[i]|^2
+void fft_power(const Float_Complex in[], float out[], size_t n);
+typedef enum {
+    FFT_LOG_EXACT,
+    // Polynomial approximation over the bits of the float. Off by at most
+    // FFT_LOG_FAST_MAX_ERROR from logf() for positive normal numbers, checked by
+    // src_bench/log.c. Zero and denormals come out as about -88 instead of -inf.
+    FFT_LOG_FAST,
+    COUNT_FFT_LOG_MODES,
+} FFT_Log_Mode;
+
+// In nepers, the units of the natural log
+#define FFT_LOG_FAST_MAX_ERROR 2e-5
+
+const char *fft_log_mode_name(FFT_Log_Mode mode);
+// out[i] = logf(in[i]). `in` and `out` may be the same array.
+void fft_log(const float in[], float out[], size_t n, FFT_Log_Mode mode);
+// out[i] = logf(|in[i]|^2)
+void fft_log_power(const Float_Complex in[], float out[], size_t n, FFT_Log_Mode mode);
+
+// The recurrence of a sliding DFT over many bins at once, see sdft.h. The bins come in `planes`
+// of `lanes` each, a multiple of FFT_BATCH_LANES, with the real and imaginary parts apart:
+// the bin l of the plane p is re[p*lanes + l] + i*im[p*lanes + l] and gets turned by the twiddle
+// wr + i*wi at the same place. For every one of the `samples` rows of `d`, `lanes` apart,
+//
+//     x = (x + d[l])*w
+//
+// for every bin, where d[l] is the same for the bin l of all of the planes.
+void fft_sdft_slide(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples);
+
+#endif // FFT_H_
+
+// NOTE: other headers like multires.h include fft.h too, so the implementation must survive
+// being included more than once
+#if defined(FFT_IMPLEMENTATION) && !defined(FFT_IMPLEMENTATION_INCLUDED_)
+#define FFT_IMPLEMENTATION_INCLUDED_
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define FFT_X86_64
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define FFT_TARGET_AVX2
+#   else
+#       define FFT_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#   endif // _MSC_VER
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   define FFT_NEON
+#   include <arm_neon.h>
+#endif
+
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif // PI
+
+// Amount of samples of FFT_Batch that go through the early stages together, see
+// fft_batch_execute()
+#define FFT_BATCH_BLOCK 512
+
+typedef struct {
+    void (*butterflies)(Float_Complex out[], size_t n, const Float_Complex twiddles[]);
+    void (*window)(const float in[], const float window[], float out[], size_t n);
+    void (*power)(const Float_Complex in[], float out[], size_t n);
+    void (*log_fast)(const float in[], float out[], size_t n);
+    // One stage of the butterflies of FFT_Batch. `lanes` is a multiple of FFT_BATCH_LANES.
+    void (*batch_stage)(float re[], float im[], size_t n, size_t h, size_t lanes, size_t stride, const Float_Complex w[]);
+    void (*sdft_slide)(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples);
+} FFT_Kernels;
+
+// FFT_LOG_FAST splits x into 2^e*m with m in [sqrt(0.5), sqrt(2)) and approximates log2(m) with
+// t*P(t) where t = m - 1. P is a degree 4 minimax fit. After the scaling by ln(2) the max error
+// of the natural log is about 1.5e-5 nepers.
+#define FFT_LOG_C1  1.4425781925f
+#define FFT_LOG_C2 -0.7202437812f
+#define FFT_LOG_C3  0.4866821126f
+#define FFT_LOG_C4 -0.3945464953f
+#define FFT_LOG_C5  0.2526469364f
+#define FFT_LOG_SQRT2 1.4142135624f
+#define FFT_LOG_SQRT_HALF_BITS 0x3F3504F3u // sqrtf(0.5f)
+#define FFT_LOG_LN2   0.6931471806f
+
+bool fft_plan_init(FFT_Plan *plan, size_t n)
+{
+    assert(n > 0 && (n & (n - 1)) == 0 && "FFT size must be a power of two");
+
+    plan->n = n;
+    plan->rev = malloc(n*sizeof(*plan->rev));
+    plan->twiddles = malloc(n*sizeof(*plan->twiddles));
+    if (plan->rev == NULL || plan->twiddles == NULL) {
+        fft_plan_free(plan);
+        return false;
+    }
+
+    size_t bits = 0;
+    while (((size_t)1 << bits) < n) bits += 1;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            if (i & ((size_t)1 << b)) r |= (uint32_t)1 << (bits - 1 - b);
+        }
+        plan->rev[i] = r;
+    }
+
+    // NOTE: t is computed exactly like the old recursive fft() did it, so the twiddles
+    // and therefore the output are bit-for-bit the same.
+    for (size_t h = 1; h < n; h *= 2) {
+        for (size_t k = 0; k < h; ++k) {
+            float t = (float)k / (2*h);
+            plan->twiddles[h - 1 + k] = cexpf(cfromimag(-2*PI*t));
+        }
+    }
+
+    return true;
+}
+
+void fft_plan_free(FFT_Plan *plan)
+{
+    free(plan->rev);
+    free(plan->twiddles);
+    plan->rev = NULL;
+    plan->twiddles = NULL;
+    plan->n = 0;
+}
+
+// Scalar Kernels
+static void fft_stage_scalar(Float_Complex out[], size_t n, size_t h, const Float_Complex w[])
+{
+    for (size_t base = 0; base < n; base += 2*h) {
+        Float_Complex *lo = out + base;
+        Float_Complex *hi = out + base + h;
+        for (size_t k = 0; k < h; ++k) {
+            Float_Complex v = mulcc(w[k], hi[k]);
+            Float_Complex e = lo[k];
+            lo[k] = addcc(e, v);
+            hi[k] = subcc(e, v);
+        }
+    }
+}
+
+static void fft_butterflies_scalar(Float_Complex out[], size_t n, const Float_Complex twiddles[])
+{
+    for (size_t h = 1; h < n; h *= 2) {
+        fft_stage_scalar(out, n, h, twiddles + h - 1);
+    }
+}
+
+static void fft_batch_stage_scalar(float re[], float im[], size_t n, size_t h, size_t lanes, size_t stride, const Float_Complex w[])
+{
+    for (size_t base = 0; base < n; base += 2*h) {
+        for (size_t k = 0; k < h; ++k) {
+            float wr = crealf(w[k]);
+            float wi = cimagf(w[k]);
+            float *lo_re = re + (base + k)*stride, *lo_im = im + (base + k)*stride;
+            float *hi_re = lo_re + h*stride, *hi_im = lo_im + h*stride;
+            for (size_t s = 0; s < lanes; ++s) {
+                float vr = hi_re[s]*wr - hi_im[s]*wi;
+                float vi = hi_im[s]*wr + hi_re[s]*wi;
+                hi_re[s] = lo_re[s] - vr;
+                hi_im[s] = lo_im[s] - vi;
+                lo_re[s] += vr;
+                lo_im[s] += vi;
+            }
+        }
+    }
+}
+
+static void fft_window_scalar(const float in[], const float window[], float out[], size_t n)
+{
+    for (size_t i = 0; i < n; ++i) out[i] = in[i]*window[i];
+}
+
+static void fft_power_scalar(const Float_Complex in[], float out[], size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        float a = crealf(in[i]);
+        float b = cimagf(in[i]);
+        out[i] = a*a + b*b;
+    }
+}
+
+static void fft_log_fast_scalar(const float in[], float out[], size_t n)
+{
+    for (size_t i = 0; i < n; ++i) {
+        // Counting the exponent from the bits of sqrt(0.5) puts the mantissa right into
+        // [sqrt(0.5), sqrt(2)) without a branch, which mispredicts on real spectra and keeps
+        // the compiler from vectorizing the loop
+        uint32_t bits;
+        memcpy(&bits, &in[i], sizeof(bits));
+        uint32_t offset = bits - FFT_LOG_SQRT_HALF_BITS;
+        float e = (float)((int32_t)offset >> 23);
+        bits = (offset & 0x007FFFFF) + FFT_LOG_SQRT_HALF_BITS;
+        float m;
+        memcpy(&m, &bits, sizeof(m));
+        float t = m - 1.0f;
+        float p = FFT_LOG_C5;
+        p = p*t + FFT_LOG_C4;
+        p = p*t + FFT_LOG_C3;
+        p = p*t + FFT_LOG_C2;
+        p = p*t + FFT_LOG_C1;
+        out[i] = (e + p*t)*FFT_LOG_LN2;
+    }
+}
+
+static void fft_sdft_slide_scalar(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples)
+{
+    for (size_t t = 0; t < samples; ++t, d += lanes) {
+        for (size_t p = 0; p < planes*lanes; p += lanes) {
+            for (size_t l = 0; l < lanes; ++l) {
+                float xr = re[p + l] + d[l];
+                float xi = im[p + l];
+                re[p + l] = xr*wr[p + l] - xi*wi[p + l];
+                im[p + l] = xr*wi[p + l] + xi*wr[p + l];
+            }
+        }
+    }
+}
+
+#ifdef FFT_X86_64
+// SSE2 Kernels
+// SSE2 is the baseline of x86_64, so these are always available there.
+
+// (xr + i*xi)*(wr + i*wi) for two interleaved complex numbers at once.
+// The products and sums happen in the same order as in the scalar code, so the result
+// is bit-for-bit the same.
+static inline __m128 fft_cmul_sse2(__m128 w, __m128 x)
+{
+    const __m128 sign = _mm_castsi128_ps(_mm_set_epi32(0, (int)0x80000000, 0, (int)0x80000000));
+    __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+    __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+    __m128 xs = _mm_shuffle_ps(x, x, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 a = _mm_mul_ps(x, wr);
+    __m128 b = _mm_xor_ps(_mm_mul_ps(xs, wi), sign);
+    return _mm_add_ps(a, b);
+}
+
+static void fft_butterflies_sse2(Float_Complex out[], size_t n, const Float_Complex twiddles[])
+{
+    size_t h = 1;
+    for (; h < n && h < 2; h *= 2) {
+        fft_stage_scalar(out, n, h, twiddles + h - 1);
+    }
+    for (; h < n; h *= 2) {
+        const float *w = (const float*)(twiddles + h - 1);
+        for (size_t base = 0; base < n; base += 2*h) {
+            float *lo = (float*)(out + base);
+            float *hi = (float*)(out + base + h);
+            for (size_t k = 0; k < 2*h; k += 4) {
+                __m128 v = fft_cmul_sse2(_mm_loadu_ps(w + k), _mm_loadu_ps(hi + k));
+                __m128 e = _mm_loadu_ps(lo + k);
+                _mm_storeu_ps(lo + k, _mm_add_ps(e, v));
+                _mm_storeu_ps(hi + k, _mm_sub_ps(e, v));
+            }
+        }
+    }
+}
+
+static void fft_batch_stage_sse2(float re[], float im[], size_t n, size_t h, size_t lanes, size_t stride, const Float_Complex w[])
+{
+    for (size_t base = 0; base < n; base += 2*h) {
+        for (size_t k = 0; k < h; ++k) {
+            __m128 wr = _mm_set1_ps(crealf(w[k]));
+            __m128 wi = _mm_set1_ps(cimagf(w[k]));
+            float *lo_re = re + (base + k)*stride, *lo_im = im + (base + k)*stride;
+            float *hi_re = lo_re + h*stride, *hi_im = lo_im + h*stride;
+            for (size_t s = 0; s < lanes; s += 4) {
+                __m128 xr = _mm_loadu_ps(hi_re + s);
+                __m128 xi = _mm_loadu_ps(hi_im + s);
+                __m128 vr = _mm_sub_ps(_mm_mul_ps(xr, wr), _mm_mul_ps(xi, wi));
+                __m128 vi = _mm_add_ps(_mm_mul_ps(xi, wr), _mm_mul_ps(xr, wi));
+                __m128 er = _mm_loadu_ps(lo_re + s);
+                __m128 ei = _mm_loadu_ps(lo_im + s);
+                _mm_storeu_ps(lo_re + s, _mm_add_ps(er, vr));
+                _mm_storeu_ps(lo_im + s, _mm_add_ps(ei, vi));
+                _mm_storeu_ps(hi_re + s, _mm_sub_ps(er, vr));
+                _mm_storeu_ps(hi_im + s, _mm_sub_ps(ei, vi));
+            }
+        }
+    }
+}
+
+static void fft_sdft_slide_sse2(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples)
+{
+    for (size_t t = 0; t < samples; ++t, d += lanes) {
+        for (size_t p = 0; p < planes*lanes; p += lanes) {
+            for (size_t l = 0; l < lanes; l += 4) {
+                __m128 xr = _mm_add_ps(_mm_loadu_ps(re + p + l), _mm_loadu_ps(d + l));
+                __m128 xi = _mm_loadu_ps(im + p + l);
+                __m128 cr = _mm_loadu_ps(wr + p + l);
+                __m128 ci = _mm_loadu_ps(wi + p + l);
+                _mm_storeu_ps(re + p + l, _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci)));
+                _mm_storeu_ps(im + p + l, _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr)));
+            }
+        }
+    }
+}
+
+static void fft_window_sse2(const float in[], const float window[], float out[], size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), _mm_loadu_ps(window + i)));
+    }
+    fft_window_scalar(in + i, window + i, out + i, n - i);
+}
+
+static void fft_power_sse2(const Float_Complex in[], float out[], size_t n)
+{
+    const float *f = (const float*)in;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(f + 2*i);
+        __m128 y = _mm_loadu_ps(f + 2*i + 4);
+        x = _mm_mul_ps(x, x);
+        y = _mm_mul_ps(y, y);
+        __m128 re = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 im = _mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_add_ps(re, im));
+    }
+    fft_power_scalar(in + i, out + i, n - i);
+}
+
+static void fft_log_fast_sse2(const float in[], float out[], size_t n)
+{
+    const __m128i mantissa = _mm_set1_epi32(0x007FFFFF);
+    const __m128i one_bits = _mm_set1_epi32(0x3F800000);
+    const __m128i bias = _mm_set1_epi32(127);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 sqrt2 = _mm_set1_ps(FFT_LOG_SQRT2);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i bits = _mm_castps_si128(_mm_loadu_ps(in + i));
+        __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), bias));
+        __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, mantissa), one_bits));
+        __m128 big = _mm_cmpgt_ps(m, sqrt2);
+        m = _mm_or_ps(_mm_andnot_ps(big, m), _mm_and_ps(big, _mm_mul_ps(m, half)));
+        e = _mm_add_ps(e, _mm_and_ps(big, one));
+        __m128 t = _mm_sub_ps(m, one);
+        __m128 p = _mm_set1_ps(FFT_LOG_C5);
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(FFT_LOG_C4));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(FFT_LOG_C3));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(FFT_LOG_C2));
+        p = _mm_add_ps(_mm_mul_ps(p, t), _mm_set1_ps(FFT_LOG_C1));
+        p = _mm_add_ps(e, _mm_mul_ps(p, t));
+        _mm_storeu_ps(out + i, _mm_mul_ps(p, _mm_set1_ps(FFT_LOG_LN2)));
+    }
+    fft_log_fast_scalar(in + i, out + i, n - i);
+}
+
+// AVX2 Kernels
+// Compiled for AVX2+FMA regardless of the global compiler flags. Must only be called
+// after checking the CPU with fft_cpu_has_avx2().
+FFT_TARGET_AVX2
+static inline __m256 fft_cmul_avx2(__m256 w, __m256 x)
+{
+    __m256 wr = _mm256_moveldup_ps(w);
+    __m256 wi = _mm256_movehdup_ps(w);
+    __m256 xs = _mm256_permute_ps(x, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm256_fmaddsub_ps(x, wr, _mm256_mul_ps(xs, wi));
+}
+
+FFT_TARGET_AVX2
+static void fft_butterflies_avx2(Float_Complex out[], size_t n, const Float_Complex twiddles[])
+{
+    size_t h = 1;
+    for (; h < n && h < 4; h *= 2) {
+        fft_stage_scalar(out, n, h, twiddles + h - 1);
+    }
+    for (; h < n; h *= 2) {
+        const float *w = (const float*)(twiddles + h - 1);
+        for (size_t base = 0; base < n; base += 2*h) {
+            float *lo = (float*)(out + base);
+            float *hi = (float*)(out + base + h);
+            for (size_t k = 0; k < 2*h; k += 8) {
+                __m256 v = fft_cmul_avx2(_mm256_loadu_ps(w + k), _mm256_loadu_ps(hi + k));
+                __m256 e = _mm256_loadu_ps(lo + k);
+                _mm256_storeu_ps(lo + k, _mm256_add_ps(e, v));
+                _mm256_storeu_ps(hi + k, _mm256_sub_ps(e, v));
+            }
+        }
+    }
+}
+
+// Eight streams at a time, the remaining four if any with the 128-bit half of the registers
+FFT_TARGET_AVX2
+static void fft_batch_stage_avx2(float re[], float im[], size_t n, size_t h, size_t lanes, size_t stride, const Float_Complex w[])
+{
+    for (size_t base = 0; base < n; base += 2*h) {
+        for (size_t k = 0; k < h; ++k) {
+            __m256 wr = _mm256_set1_ps(crealf(w[k]));
+            __m256 wi = _mm256_set1_ps(cimagf(w[k]));
+            float *lo_re = re + (base + k)*stride, *lo_im = im + (base + k)*stride;
+            float *hi_re = lo_re + h*stride, *hi_im = lo_im + h*stride;
+            size_t s = 0;
+            for (; s + 8 <= lanes; s += 8) {
+                __m256 xr = _mm256_loadu_ps(hi_re + s);
+                __m256 xi = _mm256_loadu_ps(hi_im + s);
+                __m256 vr = _mm256_fmsub_ps(xr, wr, _mm256_mul_ps(xi, wi));
+                __m256 vi = _mm256_fmadd_ps(xi, wr, _mm256_mul_ps(xr, wi));
+                __m256 er = _mm256_loadu_ps(lo_re + s);
+                __m256 ei = _mm256_loadu_ps(lo_im + s);
+                _mm256_storeu_ps(lo_re + s, _mm256_add_ps(er, vr));
+                _mm256_storeu_ps(lo_im + s, _mm256_add_ps(ei, vi));
+                _mm256_storeu_ps(hi_re + s, _mm256_sub_ps(er, vr));
+                _mm256_storeu_ps(hi_im + s, _mm256_sub_ps(ei, vi));
+            }
+            if (s < lanes) {
+                __m128 wr4 = _mm256_castps256_ps128(wr);
+                __m128 wi4 = _mm256_castps256_ps128(wi);
+                __m128 xr = _mm_loadu_ps(hi_re + s);
+                __m128 xi = _mm_loadu_ps(hi_im + s);
+                __m128 vr = _mm_fmsub_ps(xr, wr4, _mm_mul_ps(xi, wi4));
+                __m128 vi = _mm_fmadd_ps(xi, wr4, _mm_mul_ps(xr, wi4));
+                __m128 er = _mm_loadu_ps(lo_re + s);
+                __m128 ei = _mm_loadu_ps(lo_im + s);
+                _mm_storeu_ps(lo_re + s, _mm_add_ps(er, vr));
+                _mm_storeu_ps(lo_im + s, _mm_add_ps(ei, vi));
+                _mm_storeu_ps(hi_re + s, _mm_sub_ps(er, vr));
+                _mm_storeu_ps(hi_im + s, _mm_sub_ps(ei, vi));
+            }
+        }
+    }
+}
+
+// Eight bins at a time, the remaining four if any with the 128-bit half of the registers
+FFT_TARGET_AVX2
+static void fft_sdft_slide_avx2(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples)
+{
+    for (size_t t = 0; t < samples; ++t, d += lanes) {
+        for (size_t p = 0; p < planes*lanes; p += lanes) {
+            size_t l = 0;
+            for (; l + 8 <= lanes; l += 8) {
+                __m256 xr = _mm256_add_ps(_mm256_loadu_ps(re + p + l), _mm256_loadu_ps(d + l));
+                __m256 xi = _mm256_loadu_ps(im + p + l);
+                __m256 cr = _mm256_loadu_ps(wr + p + l);
+                __m256 ci = _mm256_loadu_ps(wi + p + l);
+                _mm256_storeu_ps(re + p + l, _mm256_fmsub_ps(xr, cr, _mm256_mul_ps(xi, ci)));
+                _mm256_storeu_ps(im + p + l, _mm256_fmadd_ps(xr, ci, _mm256_mul_ps(xi, cr)));
+            }
+            if (l < lanes) {
+                __m128 xr = _mm_add_ps(_mm_loadu_ps(re + p + l), _mm_loadu_ps(d + l));
+                __m128 xi = _mm_loadu_ps(im + p + l);
+                __m128 cr = _mm_loadu_ps(wr + p + l);
+                __m128 ci = _mm_loadu_ps(wi + p + l);
+                _mm_storeu_ps(re + p + l, _mm_fmsub_ps(xr, cr, _mm_mul_ps(xi, ci)));
+                _mm_storeu_ps(im + p + l, _mm_fmadd_ps(xr, ci, _mm_mul_ps(xi, cr)));
+            }
+        }
+    }
+}
+
+FFT_TARGET_AVX2
+static void fft_window_avx2(const float in[], const float window[], float out[], size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), _mm256_loadu_ps(window + i)));
+    }
+    fft_window_scalar(in + i, window + i, out + i, n - i);
+}
+
+FFT_TARGET_AVX2
+static void fft_power_avx2(const Float_Complex in[], float out[], size_t n)
+{
+    const float *f = (const float*)in;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(f + 2*i);
+        __m256 y = _mm256_loadu_ps(f + 2*i + 8);
+        // hadd works within 128-bit lanes, so the result comes out as 0 1 4 5 2 3 6 7
+        __m256 p = _mm256_hadd_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y));
+        p = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(p), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(out + i, p);
+    }
+    fft_power_scalar(in + i, out + i, n - i);
+}
+
+FFT_TARGET_AVX2
+static void fft_log_fast_avx2(const float in[], float out[], size_t n)
+{
+    const __m256i mantissa = _mm256_set1_epi32(0x007FFFFF);
+    const __m256i one_bits = _mm256_set1_epi32(0x3F800000);
+    const __m256i bias = _mm256_set1_epi32(127);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 sqrt2 = _mm256_set1_ps(FFT_LOG_SQRT2);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i bits = _mm256_castps_si256(_mm256_loadu_ps(in + i));
+        __m256 e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), bias));
+        __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, mantissa), one_bits));
+        __m256 big = _mm256_cmp_ps(m, sqrt2, _CMP_GT_OQ);
+        m = _mm256_blendv_ps(m, _mm256_mul_ps(m, half), big);
+        e = _mm256_add_ps(e, _mm256_and_ps(big, one));
+        __m256 t = _mm256_sub_ps(m, one);
+        __m256 p = _mm256_set1_ps(FFT_LOG_C5);
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(FFT_LOG_C4));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(FFT_LOG_C3));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(FFT_LOG_C2));
+        p = _mm256_fmadd_ps(p, t, _mm256_set1_ps(FFT_LOG_C1));
+        p = _mm256_fmadd_ps(p, t, e);
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(p, _mm256_set1_ps(FFT_LOG_LN2)));
+    }
+    // NOTE: GCC turns the call below into a tail jump and forgets the vzeroupper before it.
+    // The dirty upper halves then make every SSE instruction after us, logf() included, crawl.
+    _mm256_zeroupper();
+    fft_log_fast_scalar(in + i, out + i, n - i);
+}
+
+static bool fft_cpu_has_avx2(void)
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    if (!fma || !osxsave) return false;
+    // The OS must save the YMM registers on context switches
+    if ((_xgetbv(0) & 0x6) != 0x6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif // _MSC_VER
+}
+#endif // FFT_X86_64
+
+#ifdef FFT_NEON
+// NEON Kernels
+// NEON is the baseline of aarch64, so these are always available there.
+static void fft_butterflies_neon(Float_Complex out[], size_t n, const Float_Complex twiddles[])
+{
+    size_t h = 1;
+    for (; h < n && h < 4; h *= 2) {
+        fft_stage_scalar(out, n, h, twiddles + h - 1);
+    }
+    for (; h < n; h *= 2) {
+        const float *w = (const float*)(twiddles + h - 1);
+        for (size_t base = 0; base < n; base += 2*h) {
+            float *lo = (float*)(out + base);
+            float *hi = (float*)(out + base + h);
+            for (size_t k = 0; k < 2*h; k += 8) {
+                float32x4x2_t wk = vld2q_f32(w + k);
+                float32x4x2_t x = vld2q_f32(hi + k);
+                float32x4x2_t e = vld2q_f32(lo + k);
+                float32x4_t vr = vsubq_f32(vmulq_f32(x.val[0], wk.val[0]), vmulq_f32(x.val[1], wk.val[1]));
+                float32x4_t vi = vaddq_f32(vmulq_f32(x.val[1], wk.val[0]), vmulq_f32(x.val[0], wk.val[1]));
+                float32x4x2_t r;
+                r.val[0] = vaddq_f32(e.val[0], vr);
+                r.val[1] = vaddq_f32(e.val[1], vi);
+                vst2q_f32(lo + k, r);
+                r.val[0] = vsubq_f32(e.val[0], vr);
+                r.val[1] = vsubq_f32(e.val[1], vi);
+                vst2q_f32(hi + k, r);
+            }
+        }
+    }
+}
+
+static void fft_batch_stage_neon(float re[], float im[], size_t n, size_t h, size_t lanes, size_t stride, const Float_Complex w[])
+{
+    for (size_t base = 0; base < n; base += 2*h) {
+        for (size_t k = 0; k < h; ++k) {
+            float wr = crealf(w[k]);
+            float wi = cimagf(w[k]);
+            float *lo_re = re + (base + k)*stride, *lo_im = im + (base + k)*stride;
+            float *hi_re = lo_re + h*stride, *hi_im = lo_im + h*stride;
+            for (size_t s = 0; s < lanes; s += 4) {
+                float32x4_t xr = vld1q_f32(hi_re + s);
+                float32x4_t xi = vld1q_f32(hi_im + s);
+                float32x4_t vr = vsubq_f32(vmulq_n_f32(xr, wr), vmulq_n_f32(xi, wi));
+                float32x4_t vi = vaddq_f32(vmulq_n_f32(xi, wr), vmulq_n_f32(xr, wi));
+                float32x4_t er = vld1q_f32(lo_re + s);
+                float32x4_t ei = vld1q_f32(lo_im + s);
+                vst1q_f32(lo_re + s, vaddq_f32(er, vr));
+                vst1q_f32(lo_im + s, vaddq_f32(ei, vi));
+                vst1q_f32(hi_re + s, vsubq_f32(er, vr));
+                vst1q_f32(hi_im + s, vsubq_f32(ei, vi));
+            }
+        }
+    }
+}
+
+static void fft_sdft_slide_neon(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples)
+{
+    for (size_t t = 0; t < samples; ++t, d += lanes) {
+        for (size_t p = 0; p < planes*lanes; p += lanes) {
+            for (size_t l = 0; l < lanes; l += 4) {
+                float32x4_t xr = vaddq_f32(vld1q_f32(re + p + l), vld1q_f32(d + l));
+                float32x4_t xi = vld1q_f32(im + p + l);
+                float32x4_t cr = vld1q_f32(wr + p + l);
+                float32x4_t ci = vld1q_f32(wi + p + l);
+                vst1q_f32(re + p + l, vfmsq_f32(vmulq_f32(xr, cr), xi, ci));
+                vst1q_f32(im + p + l, vfmaq_f32(vmulq_f32(xr, ci), xi, cr));
+            }
+        }
+    }
+}
+
+static void fft_window_neon(const float in[], const float window[], float out[], size_t n)
+{
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), vld1q_f32(window + i)));
+    }
+    fft_window_scalar(in + i, window + i, out + i, n - i);
+}
+
+static void fft_power_neon(const Float_Complex in[], float out[], size_t n)
+{
+    const float *f = (const float*)in;
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4x2_t x = vld2q_f32(f + 2*i);
+        vst1q_f32(out + i, vaddq_f32(vmulq_f32(x.val[0], x.val[0]), vmulq_f32(x.val[1], x.val[1])));
+    }
+    fft_power_scalar(in + i, out + i, n - i);
+}
+
+static void fft_log_fast_neon(const float in[], float out[], size_t n)
+{
+    const uint32x4_t mantissa = vdupq_n_u32(0x007FFFFF);
+    const uint32x4_t one_bits = vdupq_n_u32(0x3F800000);
+    const int32x4_t bias = vdupq_n_s32(127);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    const float32x4_t sqrt2 = vdupq_n_f32(FFT_LOG_SQRT2);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t bits = vreinterpretq_u32_f32(vld1q_f32(in + i));
+        float32x4_t e = vcvtq_f32_s32(vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(bits, 23)), bias));
+        float32x4_t m = vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, mantissa), one_bits));
+        uint32x4_t big = vcgtq_f32(m, sqrt2);
+        m = vbslq_f32(big, vmulq_n_f32(m, 0.5f), m);
+        e = vaddq_f32(e, vreinterpretq_f32_u32(vandq_u32(big, vreinterpretq_u32_f32(one))));
+        float32x4_t t = vsubq_f32(m, one);
+        float32x4_t p = vdupq_n_f32(FFT_LOG_C5);
+        p = vfmaq_f32(vdupq_n_f32(FFT_LOG_C4), p, t);
+        p = vfmaq_f32(vdupq_n_f32(FFT_LOG_C3), p, t);
+        p = vfmaq_f32(vdupq_n_f32(FFT_LOG_C2), p, t);
+        p = vfmaq_f32(vdupq_n_f32(FFT_LOG_C1), p, t);
+        p = vfmaq_f32(e, p, t);
+        vst1q_f32(out + i, vmulq_n_f32(p, FFT_LOG_LN2));
+    }
+    fft_log_fast_scalar(in + i, out + i, n - i);
+}
+#endif // FFT_NEON
+
+static const FFT_Kernels fft_kernels_table[COUNT_FFT_KERNELS] = {
+    [FFT_KERNELS_SCALAR] = {fft_butterflies_scalar, fft_window_scalar, fft_power_scalar, fft_log_fast_scalar, fft_batch_stage_scalar, fft_sdft_slide_scalar},
+#ifdef FFT_X86_64
+    [FFT_KERNELS_SSE2]   = {fft_butterflies_sse2,   fft_window_sse2,   fft_power_sse2,   fft_log_fast_sse2,   fft_batch_stage_sse2,   fft_sdft_slide_sse2},
+    [FFT_KERNELS_AVX2]   = {fft_butterflies_avx2,   fft_window_avx2,   fft_power_avx2,   fft_log_fast_avx2,   fft_batch_stage_avx2,   fft_sdft_slide_avx2},
+#endif // FFT_X86_64
+#ifdef FFT_NEON
+    [FFT_KERNELS_NEON]   = {fft_butterflies_neon,   fft_window_neon,   fft_power_neon,   fft_log_fast_neon,   fft_batch_stage_neon,   fft_sdft_slide_neon},
+#endif // FFT_NEON
+};
+
+static FFT_Kernels_Kind fft_kernels_kind = FFT_KERNELS_SCALAR;
+static const FFT_Kernels *fft_kernels = &fft_kernels_table[FFT_KERNELS_SCALAR];
+
+const char *fft_kernels_name(FFT_Kernels_Kind kind)
+{
+    static_assert(COUNT_FFT_KERNELS == 4, "Amount of FFT kernels changed");
+    switch (kind) {
+        case FFT_KERNELS_SCALAR: return "scalar";
+        case FFT_KERNELS_SSE2:   return "SSE2";
+        case FFT_KERNELS_AVX2:   return "AVX2";
+        case FFT_KERNELS_NEON:   return "NEON";
+        default:                 return "unknown";
+    }
+}
+
+static bool fft_kernels_supported(FFT_Kernels_Kind kind)
+{
+    if (kind >= COUNT_FFT_KERNELS || fft_kernels_table[kind].butterflies == NULL) return false;
+#ifdef FFT_X86_64
+    if (kind == FFT_KERNELS_AVX2) return fft_cpu_has_avx2();
+#endif // FFT_X86_64
+    return true;
+}
+
+FFT_Kernels_Kind fft_kernels_best(void)
+{
+    FFT_Kernels_Kind order[] = {FFT_KERNELS_AVX2, FFT_KERNELS_NEON, FFT_KERNELS_SSE2};
+    for (size_t i = 0; i < sizeof(order)/sizeof(order[0]); ++i) {
+        if (fft_kernels_supported(order[i])) return order[i];
+    }
+    return FFT_KERNELS_SCALAR;
+}
+
+bool fft_kernels_select(FFT_Kernels_Kind kind)
+{
+    if (!fft_kernels_supported(kind)) return false;
+    fft_kernels_kind = kind;
+    fft_kernels = &fft_kernels_table[kind];
+    return true;
+}
+
+FFT_Kernels_Kind fft_kernels_current(void)
+{
+    return fft_kernels_kind;
+}
+
+void fft_window(const float in[], const float window[], float out[], size_t n)
+{
+    fft_kernels->window(in, window, out, n);
+}
+
+void fft_power(const Float_Complex in[], float out[], size_t n)
+{
+    fft_kernels->power(in, out, n);
+}
+
+const char *fft_log_mode_name(FFT_Log_Mode mode)
+{
+    static_assert(COUNT_FFT_LOG_MODES == 2, "Amount of log modes changed");
+    switch (mode) {
+        case FFT_LOG_EXACT: return "exact";
+        case FFT_LOG_FAST:  return "fast";
+        default:            return "unknown";
+    }
+}
+
+void fft_log(const float in[], float out[], size_t n, FFT_Log_Mode mode)
+{
+    switch (mode) {
+        case FFT_LOG_EXACT:
+            for (size_t i = 0; i < n; ++i) out[i] = logf(in[i]);
+            break;
+        case FFT_LOG_FAST:
+            fft_kernels->log_fast(in, out, n);
+            break;
+        default: assert(0 && "unreachable");
+    }
+}
+
+void fft_log_power(const Float_Complex in[], float out[], size_t n, FFT_Log_Mode mode)
+{
+    fft_kernels->power(in, out, n);
+    fft_log(out, out, n, mode);
+}
+
+void fft_sdft_slide(float re[], float im[], const float wr[], const float wi[], size_t lanes, size_t planes, const float d[], size_t samples)
+{
+    assert(lanes%FFT_BATCH_LANES == 0);
+    fft_kernels->sdft_slide(re, im, wr, wi, lanes, planes, d, samples);
+}
+
+static void fft_butterflies(const FFT_Plan *plan, Float_Complex out[])
+{
+    fft_kernels->butterflies(out, plan->n, plan->twiddles);
+}
+
+void fft_execute(const FFT_Plan *plan, const float in[], Float_Complex out[])
+{
+    for (size_t i = 0; i < plan->n; ++i) {
+        out[i] = cfromreal(in[plan->rev[i]]);
+    }
+    fft_butterflies(plan, out);
+}
+
+void fft_execute_complex(const FFT_Plan *plan, const Float_Complex in[], Float_Complex out[])
+{
+    for (size_t i = 0; i < plan->n; ++i) {
+        out[i] = in[plan->rev[i]];
+    }
+    fft_butterflies(plan, out);
+}
+
+bool fft_real_plan_init(FFT_Real_Plan *plan, size_t n)
+{
+    assert(n >= 4 && (n & (n - 1)) == 0 && "Real FFT size must be a power of two and at least 4");
+
+    plan->n = n;
+    plan->twiddles = malloc((n/4 + 1)*sizeof(*plan->twiddles));
+    if (plan->twiddles == NULL) return false;
+    if (!fft_plan_init(&plan->half, n/2)) {
+        free(plan->twiddles);
+        plan->twiddles = NULL;
+        return false;
+    }
+
+    for (size_t k = 0; k <= n/4; ++k) {
+        float t = (float)k / n;
+        plan->twiddles[k] = cexpf(cfromimag(-2*PI*t));
+    }
+    return true;
+}
+
+void fft_real_plan_free(FFT_Real_Plan *plan)
+{
+    fft_plan_free(&plan->half);
+    free(plan->twiddles);
+    plan->twiddles = NULL;
+    plan->n = 0;
+}
+
+void fft_real_execute(const FFT_Real_Plan *plan, const float in[], Float_Complex out[])
+{
+    size_t m = plan->n/2;
+
+    // Pairs of real samples become one complex sample: z[j] = in[2j] + i*in[2j + 1]
+    for (size_t i = 0; i < m; ++i) {
+        size_t j = plan->half.rev[i];
+        out[i] = cbuild(in[2*j], in[2*j + 1]);
+    }
+    fft_butterflies(&plan->half, out);
+
+    // Untangle Z into X. With E = (Z[k] + conj(Z[m-k]))/2 and O = -i(Z[k] - conj(Z[m-k]))/2
+    // we get X[k] = E + W^k*O and X[m-k] = conj(E - W^k*O), so each pair (k, m-k) is done
+    // in place at once.
+    float re0 = crealf(out[0]);
+    float im0 = cimagf(out[0]);
+    out[0] = cfromreal(re0 + im0);
+    out[m] = cfromreal(re0 - im0);
+
+    for (size_t k = 1; k <= m/2; ++k) {
+        Float_Complex a = out[k];
+        Float_Complex b = out[m - k];
+        float e_re = 0.5f*(crealf(a) + crealf(b));
+        float e_im = 0.5f*(cimagf(a) - cimagf(b));
+        float o_re = 0.5f*(cimagf(a) + cimagf(b));
+        float o_im = -0.5f*(crealf(a) - crealf(b));
+        Float_Complex wo = mulcc(plan->twiddles[k], cbuild(o_re, o_im));
+        float wo_re = crealf(wo);
+        float wo_im = cimagf(wo);
+        out[k]     = cbuild(e_re + wo_re, e_im + wo_im);
+        out[m - k] = cbuild(e_re - wo_re, wo_im - e_im);
+    }
+}
+
+bool fft_batch_init(FFT_Batch *batch, size_t n, size_t streams)
+{
+    assert(streams > 0);
+    memset(batch, 0, sizeof(*batch));
+    if (!fft_real_plan_init(&batch->plan, n)) return false;
+    batch->streams = streams;
+    batch->stride = (streams + FFT_BATCH_LANES - 1)/FFT_BATCH_LANES*FFT_BATCH_LANES;
+    // The padding lanes are transformed too, so they must hold numbers
+    batch->re = calloc(n/2*batch->stride, sizeof(*batch->re));
+    batch->im = calloc(n/2*batch->stride, sizeof(*batch->im));
+    if (batch->re == NULL || batch->im == NULL) {
+        fft_batch_free(batch);
+        return false;
+    }
+    return true;
+}
+
+void fft_batch_free(FFT_Batch *batch)
+{
+    fft_real_plan_free(&batch->plan);
+    free(batch->re);
+    free(batch->im);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void fft_batch_execute(FFT_Batch *batch, const float *const in[], Float_Complex *const out[], size_t count)
+{
+    assert(count <= batch->streams);
+    const FFT_Real_Plan *plan = &batch->plan;
+    size_t m = plan->n/2;
+    size_t stride = batch->stride;
+    size_t lanes = (count + FFT_BATCH_LANES - 1)/FFT_BATCH_LANES*FFT_BATCH_LANES;
+
+    // Same packing as fft_real_execute(), one stream per lane
+    for (size_t i = 0; i < m; ++i) {
+        size_t j = plan->half.rev[i];
+        float *re = batch->re + i*stride;
+        float *im = batch->im + i*stride;
+        for (size_t s = 0; s < count; ++s) {
+            re[s] = in[s][2*j];
+            im[s] = in[s][2*j + 1];
+        }
+    }
+    // With all of the streams side by side the data outgrows the cache much sooner than a
+    // single stream does. The early stages only ever mix nearby samples, so they are done a
+    // block at a time while the block is still in the cache.
+    const Float_Complex *twiddles = plan->half.twiddles;
+    size_t block = m < FFT_BATCH_BLOCK ? m : FFT_BATCH_BLOCK;
+    for (size_t base = 0; base < m; base += block) {
+        float *re = batch->re + base*stride;
+        float *im = batch->im + base*stride;
+        for (size_t h = 1; h < block; h *= 2) {
+            fft_kernels->batch_stage(re, im, block, h, lanes, stride, twiddles + h - 1);
+        }
+    }
+    for (size_t h = block; h < m; h *= 2) {
+        fft_kernels->batch_stage(batch->re, batch->im, m, h, lanes, stride, twiddles + h - 1);
+    }
+
+    // Same untangling as fft_real_execute(), straight into the outputs of the streams
+    for (size_t s = 0; s < count; ++s) {
+        float re0 = batch->re[s];
+        float im0 = batch->im[s];
+        out[s][0] = cfromreal(re0 + im0);
+        out[s][m] = cfromreal(re0 - im0);
+    }
+    for (size_t k = 1; k <= m/2; ++k) {
+        float w_re = crealf(plan->twiddles[k]);
+        float w_im = cimagf(plan->twiddles[k]);
+        const float *a_re = batch->re + k*stride, *a_im = batch->im + k*stride;
+        const float *b_re = batch->re + (m - k)*stride, *b_im = batch->im + (m - k)*stride;
+        for (size_t s = 0; s < count; ++s) {
+            float e_re = 0.5f*(a_re[s] + b_re[s]);
+            float e_im = 0.5f*(a_im[s] - b_im[s]);
+            float o_re = 0.5f*(a_im[s] + b_im[s]);
+            float o_im = -0.5f*(a_re[s] - b_re[s]);
+            float wo_re = w_re*o_re - w_im*o_im;
+            float wo_im = w_re*o_im + w_im*o_re;
+            out[s][k]     = cbuild(e_re + wo_re, e_im + wo_im);
+            out[s][m - k] = cbuild(e_re - wo_re, wo_im - e_im);
+        }
+    }
+}
+
+#endif // FFT_IMPLEMENTATION
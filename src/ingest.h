@@ -0,0 +1,156 @@
+#ifndef INGEST_H_
+#define INGEST_H_
+
+// Turns interleaved audio frames into the separate streams of samples the analyzer works on.
+//
+// The mono downmix averages all of the channels. The left/right and mid/side modes take the
+// first two channels as left and right, a mono source counts as both. Any channels past the
+// first two only make it into the mono downmix.
+
+#include <stddef.h>
+
+typedef enum {
+    INGEST_MONO,
+    INGEST_LEFT_RIGHT,
+    // Mid is (L + R)/2 and side is (L - R)/2
+    INGEST_MID_SIDE,
+    COUNT_INGEST_MODES,
+} Ingest_Mode;
+
+#define INGEST_STREAMS_MAX 2
+
+const char *ingest_mode_name(Ingest_Mode mode);
+// Amount of streams produced by the mode
+size_t ingest_streams(Ingest_Mode mode);
+// Splits `count` interleaved frames of `channels` channels into ingest_streams(mode) arrays
+// of `count` samples each
+void ingest_frames(Ingest_Mode mode, const float *frames, size_t count, size_t channels, float *out[INGEST_STREAMS_MAX]);
+
+#endif // INGEST_H_
+
+#ifdef INGEST_IMPLEMENTATION
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define INGEST_SSE2
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   define INGEST_NEON
+#   include <arm_neon.h>
+#endif
+
+const char *ingest_mode_name(Ingest_Mode mode)
+{
+    switch (mode) {
+    case INGEST_MONO:       return "Mono";
+    case INGEST_LEFT_RIGHT: return "Left/Right";
+    case INGEST_MID_SIDE:   return "Mid/Side";
+    default:                return "Unknown";
+    }
+}
+
+size_t ingest_streams(Ingest_Mode mode)
+{
+    switch (mode) {
+    case INGEST_MONO:       return 1;
+    case INGEST_LEFT_RIGHT:
+    case INGEST_MID_SIDE:   return 2;
+    default: assert(0 && "unreachable"); return 1;
+    }
+}
+
+// The stereo case is by far the most common one (raylib always hands us stereo), so it gets
+// the SIMD treatment. Every kernel does a, b = (L*ka + R*kb), (L*kc + R*kd) over the
+// deinterleaved pair, which covers all of the modes.
+typedef struct {
+    float ka, kb, kc, kd;
+} Ingest_Mix;
+
+static void ingest_stereo_scalar(const float *frames, size_t count, Ingest_Mix mix, float *a, float *b)
+{
+    for (size_t i = 0; i < count; ++i) {
+        float l = frames[2*i + 0];
+        float r = frames[2*i + 1];
+        a[i] = l*mix.ka + r*mix.kb;
+        if (b) b[i] = l*mix.kc + r*mix.kd;
+    }
+}
+
+static void ingest_stereo(const float *frames, size_t count, Ingest_Mix mix, float *a, float *b)
+{
+    size_t i = 0;
+#if defined(INGEST_SSE2)
+    __m128 ka = _mm_set1_ps(mix.ka), kb = _mm_set1_ps(mix.kb);
+    __m128 kc = _mm_set1_ps(mix.kc), kd = _mm_set1_ps(mix.kd);
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(frames + 2*i);
+        __m128 y = _mm_loadu_ps(frames + 2*i + 4);
+        __m128 l = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 r = _mm_shuffle_ps(x, y, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(a + i, _mm_add_ps(_mm_mul_ps(l, ka), _mm_mul_ps(r, kb)));
+        if (b) _mm_storeu_ps(b + i, _mm_add_ps(_mm_mul_ps(l, kc), _mm_mul_ps(r, kd)));
+    }
+#elif defined(INGEST_NEON)
+    for (; i + 4 <= count; i += 4) {
+        float32x4x2_t x = vld2q_f32(frames + 2*i);
+        vst1q_f32(a + i, vaddq_f32(vmulq_n_f32(x.val[0], mix.ka), vmulq_n_f32(x.val[1], mix.kb)));
+        if (b) vst1q_f32(b + i, vaddq_f32(vmulq_n_f32(x.val[0], mix.kc), vmulq_n_f32(x.val[1], mix.kd)));
+    }
+#endif
+    ingest_stereo_scalar(frames + 2*i, count - i, mix, a + i, b ? b + i : NULL);
+}
+
+void ingest_frames(Ingest_Mode mode, const float *frames, size_t count, size_t channels, float *out[INGEST_STREAMS_MAX])
+{
+    assert(channels > 0);
+
+    if (channels == 2) {
+        switch (mode) {
+        case INGEST_MONO:       ingest_stereo(frames, count, (Ingest_Mix) {0.5f, 0.5f, 0.0f,  0.0f}, out[0], NULL);   break;
+        case INGEST_LEFT_RIGHT: ingest_stereo(frames, count, (Ingest_Mix) {1.0f, 0.0f, 0.0f,  1.0f}, out[0], out[1]); break;
+        case INGEST_MID_SIDE:   ingest_stereo(frames, count, (Ingest_Mix) {0.5f, 0.5f, 0.5f, -0.5f}, out[0], out[1]); break;
+        default: assert(0 && "unreachable");
+        }
+        return;
+    }
+
+    if (channels == 1) {
+        memcpy(out[0], frames, count*sizeof(*frames));
+        switch (mode) {
+        case INGEST_MONO:       break;
+        case INGEST_LEFT_RIGHT: memcpy(out[1], frames, count*sizeof(*frames)); break;
+        case INGEST_MID_SIDE:   memset(out[1], 0, count*sizeof(*out[1]));      break;
+        default: assert(0 && "unreachable");
+        }
+        return;
+    }
+
+    if (mode == INGEST_MONO) {
+        float k = 1.0f/channels;
+        for (size_t i = 0; i < count; ++i) {
+            const float *frame = frames + i*channels;
+            float sum = 0.0f;
+            for (size_t c = 0; c < channels; ++c) sum += frame[c];
+            out[0][i] = sum*k;
+        }
+        return;
+    }
+
+    // More than two channels in one of the stereo modes. Pack the first two and go through
+    // the stereo path.
+    float pair[2*256];
+    for (size_t done = 0; done < count;) {
+        size_t n = count - done < 256 ? count - done : 256;
+        for (size_t i = 0; i < n; ++i) {
+            pair[2*i + 0] = frames[(done + i)*channels + 0];
+            pair[2*i + 1] = frames[(done + i)*channels + 1];
+        }
+        float *chunk[INGEST_STREAMS_MAX] = {out[0] + done, out[1] + done};
+        ingest_frames(mode, pair, n, 2, chunk);
+        done += n;
+    }
+}
+
+#endif // INGEST_IMPLEMENTATION
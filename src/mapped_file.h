@@ -0,0 +1,22 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+// Minimal memory-mapped file API. Implemented in mapped_file_posix.c and
+// mapped_file_windows.c for the same reason as thread.h.
+
+#include <stddef.h>
+
+typedef struct Mapped_File Mapped_File;
+
+// Maps the whole file for reading. Returns NULL if it does not exist, is empty or could not
+// be mapped.
+Mapped_File *mapped_file_open(const char *file_path);
+// Creates the file of `size` bytes, replacing whatever was there, and maps it for writing.
+// Returns NULL on failure.
+Mapped_File *mapped_file_create(const char *file_path, size_t size);
+void *mapped_file_data(Mapped_File *file);
+size_t mapped_file_size(Mapped_File *file);
+// Unmaps and frees the file. Whatever was written into the mapping ends up on disk.
+void mapped_file_close(Mapped_File *file);
+
+#endif // MAPPED_FILE_H_
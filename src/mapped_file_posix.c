@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <raylib.h>
+#include "mapped_file.h"
+
+struct Mapped_File {
+    void *data;
+    size_t size;
+};
+
+static Mapped_File *mapped_file_map(int fd, const char *file_path, size_t size, int prot)
+{
+    Mapped_File *file = malloc(sizeof(*file));
+    if (file == NULL) return NULL;
+    file->size = size;
+    file->data = mmap(NULL, size, prot, MAP_SHARED, fd, 0);
+    if (file->data == MAP_FAILED) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not map %s: %s", file_path, strerror(errno));
+        free(file);
+        return NULL;
+    }
+    return file;
+}
+
+Mapped_File *mapped_file_open(const char *file_path)
+{
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        if (errno != ENOENT) TraceLog(LOG_ERROR, "MAPPED_FILE: could not open %s: %s", file_path, strerror(errno));
+        return NULL;
+    }
+
+    Mapped_File *file = NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not get the size of %s: %s", file_path, strerror(errno));
+    } else if (st.st_size > 0) {
+        file = mapped_file_map(fd, file_path, st.st_size, PROT_READ);
+    }
+    // NOTE: the mapping stays valid after the descriptor is closed
+    close(fd);
+    return file;
+}
+
+Mapped_File *mapped_file_create(const char *file_path, size_t size)
+{
+    int fd = open(file_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not create %s: %s", file_path, strerror(errno));
+        return NULL;
+    }
+
+    Mapped_File *file = NULL;
+    if (ftruncate(fd, size) < 0) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not resize %s: %s", file_path, strerror(errno));
+    } else {
+        file = mapped_file_map(fd, file_path, size, PROT_READ | PROT_WRITE);
+    }
+    close(fd);
+    return file;
+}
+
+void *mapped_file_data(Mapped_File *file)
+{
+    return file->data;
+}
+
+size_t mapped_file_size(Mapped_File *file)
+{
+    return file->size;
+}
+
+void mapped_file_close(Mapped_File *file)
+{
+    munmap(file->data, file->size);
+    free(file);
+}
@@ -0,0 +1,92 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define _WINUSER_
+#define _WINGDI_
+#define _IMM_
+#define _WINCON_
+#include <windows.h>
+
+#include <raylib.h>
+#include "mapped_file.h"
+
+struct Mapped_File {
+    void *data;
+    size_t size;
+};
+
+static Mapped_File *mapped_file_map(HANDLE handle, const char *file_path, size_t size, bool writable)
+{
+    Mapped_File *file = malloc(sizeof(*file));
+    if (file == NULL) return NULL;
+    file->size = size;
+    file->data = NULL;
+
+    DWORD protect = writable ? PAGE_READWRITE : PAGE_READONLY;
+    HANDLE mapping = CreateFileMappingA(handle, NULL, protect, (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    if (mapping != NULL) {
+        file->data = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+        // NOTE: the view keeps the mapping alive after the handle is closed
+        CloseHandle(mapping);
+    }
+    if (file->data == NULL) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not map %s. System Error Code: %d", file_path, GetLastError());
+        free(file);
+        return NULL;
+    }
+    return file;
+}
+
+Mapped_File *mapped_file_open(const char *file_path)
+{
+    HANDLE handle = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        DWORD error = GetLastError();
+        if (error != ERROR_FILE_NOT_FOUND && error != ERROR_PATH_NOT_FOUND) {
+            TraceLog(LOG_ERROR, "MAPPED_FILE: could not open %s. System Error Code: %d", file_path, error);
+        }
+        return NULL;
+    }
+
+    Mapped_File *file = NULL;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not get the size of %s. System Error Code: %d", file_path, GetLastError());
+    } else if (size.QuadPart > 0) {
+        file = mapped_file_map(handle, file_path, size.QuadPart, false);
+    }
+    CloseHandle(handle);
+    return file;
+}
+
+Mapped_File *mapped_file_create(const char *file_path, size_t size)
+{
+    HANDLE handle = CreateFileA(file_path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        TraceLog(LOG_ERROR, "MAPPED_FILE: could not create %s. System Error Code: %d", file_path, GetLastError());
+        return NULL;
+    }
+
+    // The mapping grows the file to `size` on its own
+    Mapped_File *file = mapped_file_map(handle, file_path, size, true);
+    CloseHandle(handle);
+    return file;
+}
+
+void *mapped_file_data(Mapped_File *file)
+{
+    return file->data;
+}
+
+size_t mapped_file_size(Mapped_File *file)
+{
+    return file->size;
+}
+
+void mapped_file_close(Mapped_File *file)
+{
+    UnmapViewOfFile(file->data);
+    free(file);
+}
@@ -0,0 +1,276 @@
+#ifndef MULTIRES_H_
+#define MULTIRES_H_
+
+// Multi-resolution (constant-Q like) spectrum analyzer.
+//
+// Instead of one big FFT of n samples it runs a small FFT of level_size samples on every
+// octave of the signal. Level 0 is the signal itself, level k is the signal low-passed and
+// decimated by 2^k. The deepest level sees the same n samples as the big FFT and has the same
+// frequency resolution, while the higher levels look at shorter and shorter windows, so the
+// time resolution grows with the frequency.
+//
+// The levels are kept up to date incrementally: multires_push() only filters the samples
+// that are new since the last time, so the cost of decimation is proportional to the hop and
+// not to n.
+//
+// The bins are addressed in the units of the full n-sized FFT, so the log bands that used to
+// be squashed out of the big FFT can be taken from here without changing their layout.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fft.h"
+
+#define MULTIRES_LEVEL_SIZE_DEFAULT 1024
+
+typedef struct {
+    float *history; // The latest samples of the level, oldest first
+    size_t count;   // Amount of samples in history
+    bool odd;       // Whether the amount of samples ever pushed into this level is odd
+} Multires_Level;
+
+typedef struct {
+    size_t n;          // Size of the full-resolution FFT being imitated. Power of two.
+    size_t level_size; // Size of the FFT of every level. Power of two, at most n.
+    size_t levels;     // log2(n/level_size) + 1
+    Multires_Level *level;
+    FFT_Real_Plan plan;
+    float *scratch[2]; // n/2 entries each. Decimated samples on their way to the next level.
+    float *in_win;     // level_size entries
+    Float_Complex *out_raw; // level_size/2 + 1 entries
+    float *power;      // levels*level_size/2 entries. Log power of every level.
+    float gain;        // Added to the log power so it's on the same scale as the big FFT
+} Multires;
+
+bool multires_init(Multires *mr, size_t n, size_t level_size);
+void multires_free(Multires *mr);
+// Forgets everything that was pushed so far. Starts over from silence.
+void multires_reset(Multires *mr);
+// Appends new samples to the signal. Pushing n samples after a reset fills every level.
+void multires_push(Multires *mr, const float samples[], size_t count);
+// Computes the log power of every level from the latest samples. `window` has level_size entries.
+void multires_execute(Multires *mr, const float window[], FFT_Log_Mode log_mode);
+// Maximum log power over the full-resolution bins [q0, q1) after multires_execute()
+float multires_band(const Multires *mr, size_t q0, size_t q1);
+// Same as multires_band(), but the log of the mean power instead of the maximum
+float multires_band_mean(const Multires *mr, size_t q0, size_t q1);
+
+#endif // MULTIRES_H_
+
+#ifdef MULTIRES_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif // PI
+
+// Half-band low-pass filter with 4*MULTIRES_HALFBAND_Q - 1 taps. Every other tap of a
+// half-band filter is zero except the center one, which is exactly 0.5, so only
+// MULTIRES_HALFBAND_Q distinct coefficients are left.
+#define MULTIRES_HALFBAND_Q 4
+#define MULTIRES_HALFBAND_TAPS (4*MULTIRES_HALFBAND_Q - 1)
+
+// Every level keeps level_size samples for its FFT plus enough of the past for the filter.
+// The history buffer is twice that, so it only has to be compacted once in a while.
+#define MULTIRES_KEEP(mr) ((mr)->level_size + MULTIRES_HALFBAND_TAPS)
+#define MULTIRES_HISTORY_CAPACITY(mr) (2*MULTIRES_KEEP(mr))
+
+static float multires_halfband[MULTIRES_HALFBAND_Q];
+
+static void multires_halfband_init(void)
+{
+    // Blackman windowed sinc with the cutoff at a quarter of the sample rate. The window is
+    // two samples longer than the filter so the outermost taps don't end up being zero.
+    float c = (MULTIRES_HALFBAND_TAPS - 1)/2;
+    float sum = 0.0f;
+    for (size_t i = 0; i < MULTIRES_HALFBAND_Q; ++i) {
+        float d = 2*i + 1;
+        float x = (c + d + 1)/(MULTIRES_HALFBAND_TAPS + 1);
+        float w = 0.42f - 0.5f*cosf(2*PI*x) + 0.08f*cosf(4*PI*x);
+        multires_halfband[i] = sinf(PI*d/2)/(PI*d)*w;
+        sum += multires_halfband[i];
+    }
+    // The taps must add up to 1, and the center one is 0.5 already
+    for (size_t i = 0; i < MULTIRES_HALFBAND_Q; ++i) {
+        multires_halfband[i] *= 0.25f/sum;
+    }
+}
+
+// Low-passed signal at x[0], which is the center of the filter. The filter reaches
+// 2*Q - 1 samples into both directions.
+static inline float multires_halfband_at(const float *x)
+{
+    const float *h = multires_halfband;
+    float acc = 0.5f*x[0];
+    for (size_t i = 0; i < MULTIRES_HALFBAND_Q; ++i) {
+        acc += h[i]*(x[-(long)(2*i + 1)] + x[2*i + 1]);
+    }
+    return acc;
+}
+
+bool multires_init(Multires *mr, size_t n, size_t level_size)
+{
+    assert(n > 0 && (n & (n - 1)) == 0 && "Multires size must be a power of two");
+    assert(level_size >= 4 && (level_size & (level_size - 1)) == 0);
+    memset(mr, 0, sizeof(*mr));
+    if (level_size > n) level_size = n;
+
+    mr->n = n;
+    mr->level_size = level_size;
+    mr->levels = 1;
+    while ((level_size << (mr->levels - 1)) < n) mr->levels += 1;
+    mr->gain = 2.0f*logf((float)n/level_size);
+
+    bool ok = fft_real_plan_init(&mr->plan, level_size);
+    mr->level = calloc(mr->levels, sizeof(*mr->level));
+    mr->scratch[0] = malloc(n/2*sizeof(*mr->scratch[0]));
+    mr->scratch[1] = malloc(n/2*sizeof(*mr->scratch[1]));
+    mr->in_win = malloc(level_size*sizeof(*mr->in_win));
+    mr->out_raw = malloc((level_size/2 + 1)*sizeof(*mr->out_raw));
+    mr->power = calloc(mr->levels*level_size/2, sizeof(*mr->power));
+    ok = ok && mr->level && mr->scratch[0] && mr->scratch[1] && mr->in_win &&
+         mr->out_raw && mr->power;
+    for (size_t k = 0; ok && k < mr->levels; ++k) {
+        mr->level[k].history = malloc(MULTIRES_HISTORY_CAPACITY(mr)*sizeof(*mr->level[k].history));
+        ok = mr->level[k].history != NULL;
+    }
+    if (!ok) {
+        multires_free(mr);
+        return false;
+    }
+
+    multires_halfband_init();
+    multires_reset(mr);
+    return true;
+}
+
+void multires_free(Multires *mr)
+{
+    if (mr->level) {
+        for (size_t k = 0; k < mr->levels; ++k) free(mr->level[k].history);
+    }
+    free(mr->level);
+    fft_real_plan_free(&mr->plan);
+    free(mr->scratch[0]);
+    free(mr->scratch[1]);
+    free(mr->in_win);
+    free(mr->out_raw);
+    free(mr->power);
+    memset(mr, 0, sizeof(*mr));
+}
+
+void multires_reset(Multires *mr)
+{
+    for (size_t k = 0; k < mr->levels; ++k) {
+        Multires_Level *l = &mr->level[k];
+        l->count = MULTIRES_KEEP(mr);
+        l->odd = false;
+        memset(l->history, 0, l->count*sizeof(*l->history));
+    }
+}
+
+static void multires_level_push(Multires *mr, size_t k, const float samples[], size_t count)
+{
+    Multires_Level *l = &mr->level[k];
+    bool deepest = k + 1 == mr->levels;
+    float *out = mr->scratch[k%2];
+    size_t out_count = 0;
+
+    while (count > 0) {
+        size_t chunk = count;
+        if (chunk > mr->level_size) chunk = mr->level_size;
+        if (l->count + chunk > MULTIRES_HISTORY_CAPACITY(mr)) {
+            size_t keep = MULTIRES_KEEP(mr);
+            memmove(l->history, l->history + l->count - keep, keep*sizeof(*l->history));
+            l->count = keep;
+        }
+
+        float *dst = l->history + l->count;
+        memcpy(dst, samples, chunk*sizeof(*samples));
+        l->count += chunk;
+
+        // Every other sample completes a pair that turns into one sample of the next level.
+        // The filter is centered 2*Q - 1 samples in the past, so it never needs the future.
+        if (!deepest) {
+            for (size_t i = 0; i < chunk; ++i) {
+                l->odd = !l->odd;
+                if (!l->odd) {
+                    out[out_count++] = multires_halfband_at(dst + i - (2*MULTIRES_HALFBAND_Q - 1));
+                }
+            }
+        }
+
+        samples += chunk;
+        count -= chunk;
+    }
+
+    if (!deepest && out_count > 0) multires_level_push(mr, k + 1, out, out_count);
+}
+
+void multires_push(Multires *mr, const float samples[], size_t count)
+{
+    // Only the latest n samples can make it into any of the levels
+    if (count > mr->n) {
+        samples += count - mr->n;
+        count = mr->n;
+    }
+    multires_level_push(mr, 0, samples, count);
+}
+
+void multires_execute(Multires *mr, const float window[], FFT_Log_Mode log_mode)
+{
+    size_t half = mr->level_size/2;
+    for (size_t k = 0; k < mr->levels; ++k) {
+        Multires_Level *l = &mr->level[k];
+        fft_window(l->history + l->count - mr->level_size, window, mr->in_win, mr->level_size);
+        fft_real_execute(&mr->plan, mr->in_win, mr->out_raw);
+        float *power = mr->power + k*half;
+        fft_log_power(mr->out_raw, power, half, log_mode);
+        for (size_t i = 0; i < half; ++i) power[i] += mr->gain;
+    }
+}
+
+// Finds the level with the right resolution for the full-resolution bins [q0, q1) and the
+// range of its bins [*i0, *i1) that covers them. Returns the log power of that level.
+static const float *multires_band_range(const Multires *mr, size_t q0, size_t q1, size_t *i0, size_t *i1)
+{
+    assert(q0 < q1);
+    // Go one octave deeper while the band starts below the upper half of the current level
+    size_t k = 0;
+    while (k + 1 < mr->levels && q0 < (mr->n >> (k + 2))) k += 1;
+
+    // One bin of level k covers that many full-resolution bins
+    size_t s = mr->n/(mr->level_size << k);
+    size_t half = mr->level_size/2;
+    *i0 = q0/s;
+    *i1 = (q1 + s - 1)/s;
+    if (*i1 > half) *i1 = half;
+    if (*i0 >= *i1) *i0 = *i1 - 1;
+    return mr->power + k*half;
+}
+
+float multires_band(const Multires *mr, size_t q0, size_t q1)
+{
+    size_t i0, i1;
+    const float *power = multires_band_range(mr, q0, q1, &i0, &i1);
+    float a = power[i0];
+    for (size_t i = i0 + 1; i < i1; ++i) {
+        if (power[i] > a) a = power[i];
+    }
+    return a;
+}
+
+float multires_band_mean(const Multires *mr, size_t q0, size_t q1)
+{
+    size_t i0, i1;
+    const float *power = multires_band_range(mr, q0, q1, &i0, &i1);
+    float a = 0.0f;
+    for (size_t i = i0; i < i1; ++i) a += expf(power[i]);
+    return logf(a/(i1 - i0));
+}
+
+#endif // MULTIRES_IMPLEMENTATION
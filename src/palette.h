@@ -0,0 +1,304 @@
+#ifndef PALETTE_H_
+#define PALETTE_H_
+
+// Colors of the bars.
+//
+// A palette is a gradient of up to PALETTE_STOPS_MAX colors at positions within 0..1, linearly
+// interpolated in between. The bars sample it at evenly spaced positions that only depend on
+// the amount of bars, so a Palette_Table samples it once per amount and the rendering just
+// reads the colors from there.
+//
+// Besides the built-in palettes there are the themes of the user, one per line of text:
+//
+//     Sunset: #2d1b69 #b8336a #f7b267@0.8 #ffe8a3
+//
+// The first color is at 0 and the last one at 1 unless they say otherwise, and the colors
+// without a position are spread evenly between their neighbours. Blank lines and the lines
+// starting with // are skipped.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PALETTE_STOPS_MAX 16
+#define PALETTE_NAME_MAX 32
+
+// The same layout as Color of raylib
+typedef struct {
+    uint8_t r, g, b, a;
+} Palette_Color;
+
+typedef struct {
+    float position;
+    Palette_Color color;
+} Palette_Stop;
+
+typedef struct {
+    char name[PALETTE_NAME_MAX];
+    size_t count;
+    Palette_Stop stops[PALETTE_STOPS_MAX]; // Ascending positions
+} Palette;
+
+// The colors of `count` bars that go over [from, from + range) of a palette
+typedef struct {
+    const Palette *palette;
+    float from;
+    float range;
+    size_t count;
+    size_t capacity;
+    Palette_Color *colors;
+} Palette_Table;
+
+size_t palette_builtin_count(void);
+const Palette *palette_builtin(size_t index);
+// The color at `t`. The positions outside of 0..1 wrap around.
+Palette_Color palette_sample(const Palette *palette, float t);
+// Parses a single line of a theme. Returns false if it's not a theme.
+bool palette_parse(Palette *palette, const char *line, size_t line_size);
+// Parses every line of `text` into `palettes`, up to `capacity` of them. Returns the amount of
+// palettes, and the 1-based line of the first broken theme in `error_line`, or 0.
+size_t palette_parse_themes(const char *text, Palette palettes[], size_t capacity, size_t *error_line);
+// Resamples the table if any of the arguments are different from last time and returns its
+// colors. The table only remembers the pointer to the palette, see palette_table_reset().
+const Palette_Color *palette_table_update(Palette_Table *table, const Palette *palette, size_t count, float from, float range);
+// Forces the next palette_table_update() to resample. For when the palette changes in place.
+void palette_table_reset(Palette_Table *table);
+void palette_table_free(Palette_Table *table);
+
+#endif // PALETTE_H_
+
+#if defined(PALETTE_IMPLEMENTATION) && !defined(PALETTE_IMPLEMENTATION_INCLUDED_)
+#define PALETTE_IMPLEMENTATION_INCLUDED_
+
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PALETTE_RGB(hex) {((hex) >> 16) & 0xFF, ((hex) >> 8) & 0xFF, (hex) & 0xFF, 0xFF}
+
+static const Palette palette_builtins[] = {
+    // ColorFromHSV(hue, 0.75, 1.0) all the way around. With the saturation and the value fixed
+    // the channels are piecewise linear in the hue, so the gradient is exact.
+    {
+        .name = "Rainbow",
+        .count = 7,
+        .stops = {
+            {0.0f/6.0f, PALETTE_RGB(0xFF3F3F)},
+            {1.0f/6.0f, PALETTE_RGB(0xFFFF3F)},
+            {2.0f/6.0f, PALETTE_RGB(0x3FFF3F)},
+            {3.0f/6.0f, PALETTE_RGB(0x3FFFFF)},
+            {4.0f/6.0f, PALETTE_RGB(0x3F3FFF)},
+            {5.0f/6.0f, PALETTE_RGB(0xFF3FFF)},
+            {6.0f/6.0f, PALETTE_RGB(0xFF3F3F)},
+        },
+    },
+    {
+        .name = "Fire",
+        .count = 4,
+        .stops = {
+            {0.00f, PALETTE_RGB(0xA01414)},
+            {0.35f, PALETTE_RGB(0xE63B19)},
+            {0.70f, PALETTE_RGB(0xFF9A1F)},
+            {1.00f, PALETTE_RGB(0xFFE566)},
+        },
+    },
+    {
+        .name = "Ocean",
+        .count = 4,
+        .stops = {
+            {0.00f, PALETTE_RGB(0x2B4FC7)},
+            {0.40f, PALETTE_RGB(0x1E88E5)},
+            {0.75f, PALETTE_RGB(0x26C6DA)},
+            {1.00f, PALETTE_RGB(0xB2FFEC)},
+        },
+    },
+    {
+        .name = "Synthwave",
+        .count = 3,
+        .stops = {
+            {0.0f, PALETTE_RGB(0xFF2FD0)},
+            {0.5f, PALETTE_RGB(0x8E44FF)},
+            {1.0f, PALETTE_RGB(0x2DE2E6)},
+        },
+    },
+};
+
+size_t palette_builtin_count(void)
+{
+    return sizeof(palette_builtins)/sizeof(palette_builtins[0]);
+}
+
+const Palette *palette_builtin(size_t index)
+{
+    assert(index < palette_builtin_count());
+    return &palette_builtins[index];
+}
+
+static uint8_t palette_lerp(uint8_t a, uint8_t b, float t)
+{
+    return (uint8_t)(a + (b - a)*t + 0.5f);
+}
+
+Palette_Color palette_sample(const Palette *palette, float t)
+{
+    assert(palette->count > 0);
+    if (t < 0.0f || t > 1.0f) t -= floorf(t);
+
+    const Palette_Stop *stops = palette->stops;
+    size_t count = palette->count;
+    if (t <= stops[0].position) return stops[0].color;
+    if (t >= stops[count - 1].position) return stops[count - 1].color;
+
+    size_t i = 1;
+    while (stops[i].position < t) i += 1;
+    const Palette_Stop *a = &stops[i - 1];
+    const Palette_Stop *b = &stops[i];
+    float u = (t - a->position)/(b->position - a->position);
+    return (Palette_Color) {
+        palette_lerp(a->color.r, b->color.r, u),
+        palette_lerp(a->color.g, b->color.g, u),
+        palette_lerp(a->color.b, b->color.b, u),
+        palette_lerp(a->color.a, b->color.a, u),
+    };
+}
+
+static int palette_hex_digit(char c)
+{
+    if ('0' <= c && c <= '9') return c - '0';
+    if ('a' <= c && c <= 'f') return c - 'a' + 10;
+    if ('A' <= c && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool palette_parse(Palette *palette, const char *line, size_t line_size)
+{
+    memset(palette, 0, sizeof(*palette));
+    const char *end = line + line_size;
+    const char *colon = memchr(line, ':', line_size);
+    if (colon == NULL) return false;
+
+    const char *name = line;
+    while (name < colon && isspace((unsigned char)*name)) name += 1;
+    const char *name_end = colon;
+    while (name_end > name && isspace((unsigned char)name_end[-1])) name_end -= 1;
+    size_t name_size = name_end - name;
+    if (name_size == 0) return false;
+    if (name_size >= PALETTE_NAME_MAX) name_size = PALETTE_NAME_MAX - 1;
+    memcpy(palette->name, name, name_size);
+
+    // NAN marks the stops that are spread out afterwards
+    const char *s = colon + 1;
+    for (;;) {
+        while (s < end && isspace((unsigned char)*s)) s += 1;
+        if (s >= end) break;
+        if (palette->count >= PALETTE_STOPS_MAX) return false;
+        if (end - s < 7 || *s != '#') return false;
+
+        uint32_t hex = 0;
+        for (size_t i = 1; i <= 6; ++i) {
+            int digit = palette_hex_digit(s[i]);
+            if (digit < 0) return false;
+            hex = hex*16 + digit;
+        }
+        s += 7;
+
+        Palette_Stop *stop = &palette->stops[palette->count++];
+        stop->color = (Palette_Color) PALETTE_RGB(hex);
+        stop->position = NAN;
+        if (s < end && *s == '@') {
+            s += 1;
+            char number[32];
+            size_t n = 0;
+            while (s < end && !isspace((unsigned char)*s) && n + 1 < sizeof(number)) number[n++] = *s++;
+            number[n] = '\0';
+            char *number_end = NULL;
+            float position = strtof(number, &number_end);
+            if (n == 0 || *number_end != '\0' || !(0.0f <= position && position <= 1.0f)) return false;
+            stop->position = position;
+        }
+        if (s < end && !isspace((unsigned char)*s)) return false;
+    }
+    if (palette->count == 0) return false;
+
+    Palette_Stop *stops = palette->stops;
+    size_t count = palette->count;
+    if (isnan(stops[0].position)) stops[0].position = 0.0f;
+    if (isnan(stops[count - 1].position)) stops[count - 1].position = count > 1 ? 1.0f : 0.0f;
+    for (size_t i = 1; i < count; ++i) {
+        if (!isnan(stops[i].position)) continue;
+        size_t j = i;
+        while (isnan(stops[j].position)) j += 1;
+        float from = stops[i - 1].position;
+        float step = (stops[j].position - from)/(j - i + 1);
+        for (size_t k = i; k < j; ++k) stops[k].position = from + step*(k - i + 1);
+    }
+    for (size_t i = 1; i < count; ++i) {
+        if (stops[i].position < stops[i - 1].position) return false;
+    }
+    return true;
+}
+
+size_t palette_parse_themes(const char *text, Palette palettes[], size_t capacity, size_t *error_line)
+{
+    size_t count = 0;
+    *error_line = 0;
+    size_t line_number = 0;
+    while (*text != '\0') {
+        line_number += 1;
+        const char *line = text;
+        const char *newline = strchr(line, '\n');
+        size_t line_size = newline ? (size_t)(newline - line) : strlen(line);
+        text = newline ? newline + 1 : line + line_size;
+
+        const char *s = line;
+        while (s < line + line_size && isspace((unsigned char)*s)) s += 1;
+        if (s == line + line_size) continue;
+        if (line + line_size - s >= 2 && s[0] == '/' && s[1] == '/') continue;
+
+        if (count >= capacity) break;
+        if (palette_parse(&palettes[count], line, line_size)) {
+            count += 1;
+        } else if (*error_line == 0) {
+            *error_line = line_number;
+        }
+    }
+    return count;
+}
+
+const Palette_Color *palette_table_update(Palette_Table *table, const Palette *palette, size_t count, float from, float range)
+{
+    if (table->palette == palette && table->count == count && table->from == from && table->range == range) {
+        return table->colors;
+    }
+
+    if (count > table->capacity) {
+        size_t capacity = table->capacity > 0 ? table->capacity : 256;
+        while (capacity < count) capacity *= 2;
+        table->colors = realloc(table->colors, capacity*sizeof(*table->colors));
+        assert(table->colors != NULL && "Buy more RAM lol");
+        table->capacity = capacity;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        table->colors[i] = palette_sample(palette, from + range*i/count);
+    }
+    table->palette = palette;
+    table->count = count;
+    table->from = from;
+    table->range = range;
+    return table->colors;
+}
+
+void palette_table_reset(Palette_Table *table)
+{
+    table->palette = NULL;
+}
+
+void palette_table_free(Palette_Table *table)
+{
+    free(table->colors);
+    memset(table, 0, sizeof(*table));
+}
+
+#endif // PALETTE_IMPLEMENTATION
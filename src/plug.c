@@ -9,11 +9,38 @@
 #include "build/config.h"
 #include "plug.h"
 #include "ffmpeg.h"
+#include "thread.h"
+#include "mapped_file.h"
+#include "triple_buffer.h"
 #define NOB_IMPLEMENTATION
 #include "nob.h"
+#define RING_IMPLEMENTATION
+#include "ring.h"
+#define FFT_IMPLEMENTATION
+#include "fft.h"
+#define MULTIRES_IMPLEMENTATION
+#include "multires.h"
+#define BANDS_IMPLEMENTATION
+#include "bands.h"
+#define WINDOW_IMPLEMENTATION
+#include "window.h"
+#define SDFT_IMPLEMENTATION
+#include "sdft.h"
+#define INGEST_IMPLEMENTATION
+#include "ingest.h"
+#define DECIMATOR_IMPLEMENTATION
+#include "decimator.h"
+#define SPECTROGRAM_IMPLEMENTATION
+#include "spectrogram.h"
+#define PALETTE_IMPLEMENTATION
+#include "palette.h"
+#define RASTER_IMPLEMENTATION
+#include "raster.h"
 
 #include <raylib.h>
 #include <rlgl.h>
+#define RAYMATH_STATIC_INLINE
+#include <raymath.h>
 
 #if defined(_WIN32) && defined(MUSIALIZER_HOTRELOAD)
     #define MUSIALIZER_PLUG __declspec(dllexport)
@@ -58,14 +85,80 @@ MUSIALIZER_PLUG void *plug_load_resource(const char *file_path, size_t *size) {
 #define _WINDOWS_
 #include "external/miniaudio.h"
 #include "external/dr_wav.h"
-
-#define FFT_SIZE (1 << 15)
+#include "external/dr_mp3.h"
+#include "external/dr_flac.h"
+#include "external/qoa.h"
+#define STB_VORBIS_HEADER_ONLY
+#include "external/stb_vorbis.c"
+
+#define FFT_SIZE_MIN (1 << 10)
+#define FFT_SIZE_MAX (1 << 16)
+#define FFT_SIZE_DEFAULT (1 << 15)
+#define FFT_HOP_MIN 64
+#define FFT_HOP_DEFAULT 256
+#define ANALYSIS_FPS 120
+#define ANALYSIS_OCTAVE_DIVISIONS 12
+// NOTE: raylib hands the audio to our callback already converted to the sample rate of the
+// playback device, but doesn't tell us what that rate is. So the analysis thread measures it
+// and we start from a reasonable guess.
+#define ANALYSIS_SAMPLE_RATE_DEFAULT 44100
+// Faster sources are decimated down to at most this rate before the analysis, see decimator.h
+#define ANALYSIS_SAMPLE_RATE_MAX 48000
+// The stems of a track replace its own audio in the analysis, see Stems
+#define STEMS_MAX 8
+#define STEMS_DIR_SUFFIX ".stems"
+#define STEMS_EXTENSIONS ".wav;.ogg;.mp3;.flac;.qoa"
+// How far the stems may drift from the playback before they jump after it, see fft_follow_track()
+#define STEMS_RESYNC_SECS 0.1
+// Spread evenly over the track, so a seek into an MP3 decodes at most the length of the track
+// divided by this before the position, see prefill_decode()
+#define PREFILL_MP3_SEEK_POINTS 1024
+// Every stream of samples coming out of the ingest or the stems gets a ring and an analyzer
+// of its own
+#define ANALYSIS_STREAMS_MAX STEMS_MAX
+static_assert(INGEST_STREAMS_MAX <= ANALYSIS_STREAMS_MAX, "Not enough analyzers for the ingest modes");
+// With fewer streams the padding of the lanes of FFT_Batch costs more than batching saves
+#define ANALYSIS_BATCH_MIN 3
+// NOTE: raylib converts everything to the channels of the playback device (AUDIO_DEVICE_CHANNELS
+// in its config.h) before our callback sees it, so mono files come in duplicated and surround
+// ones downmixed. The microphone is captured in stereo as well.
+#define PLAYBACK_CHANNELS 2
+// NOTE: the callback gets the samples while the device pulls them, which is a few periods
+// before they are heard. raylib doesn't tell us about the device either, so we measure the
+// period and assume miniaudio queues its default amount of them (MA_DEFAULT_PERIODS), since
+// raylib doesn't ask for anything else. See fft_playback_delay().
+#define PLAYBACK_PERIODS 3
+// The pieces of a period raylib hands over arrive within this much time of each other
+#define PLAYBACK_BURST_SECS 0.001
+// Manual correction on top of the measured latency, for the outputs that add their own
+#define LATENCY_OFFSET_MAX_MS 500
+#define LATENCY_OFFSET_STEP_MS 10
+#define LATENCY_MAX_FRAMES FFT_SIZE_MAX
 #define FONT_SIZE 64
 
 #define RENDER_FPS 60
 #define RENDER_FACTOR 120
 #define RENDER_WIDTH (16 * RENDER_FACTOR)
 #define RENDER_HEIGHT (9 * RENDER_FACTOR)
+// FFT size used for rendering videos. 0 means the same size as in the preview.
+#define RENDER_FFT_SIZE 0
+#define PRECOMPUTE_BLOCK_FRAMES 64
+#define PRECOMPUTE_WORKERS_MAX 16
+// Where the bands of the analyzed tracks are kept, see spectrogram.h
+#define CACHE_DIR "musializer-cache"
+// The palettes of the user on top of the built-in ones, see palette.h
+#define THEMES_PATH "musializer-themes.txt"
+#define PALETTES_MAX 32
+// Amount of texels of the palette for spectrum.fs
+#define PALETTE_TEXTURE_SIZE 256
+// See fft_render_bloom()
+#define BLOOM_LEVELS 5
+#define BLOOM_THRESHOLD 0.2f
+#define BLOOM_INTENSITY 1.5f
+#define BLOOM_GLOW_SCALE 0.25f
+// See fft_rasterize()
+#define RASTER_TILE_ROWS 16
+#define RASTER_WORKERS_MAX 16
 
 #define COLOR_ACCENT                       ColorFromHSV(225, 0.75, 0.8)
 #define COLOR_BACKGROUND                   GetColor(0x151515FF)
@@ -96,29 +189,31 @@ MUSIALIZER_PLUG void *plug_load_resource(const char *file_path, size_t *size) {
 #define KEY_FULLSCREEN            KEY_F
 #define KEY_CAPTURE_MICROPHONE    KEY_C
 #define KEY_TOGGLE_MUTE           KEY_M
-
-// Microsoft could not update their parser OMEGALUL
-// https://learn.microsoft.com/en-us/cpp/c-runtime-library/complex-math-support?view=msvc-170#types-used-in-complex-math
-#ifdef _MSC_VER
-#   define Float_Complex _Fcomplex
-#   define cfromreal(re) _FCbuild(re, 0)
-#   define cfromimag(im) _FCbuild(0, im)
-#   define mulcc _FCmulcc
-#   define addcc(a, b) _FCbuild(crealf(a) + crealf(b), cimagf(a) + cimagf(b))
-#   define subcc(a, b) _FCbuild(crealf(a) - crealf(b), cimagf(a) - cimagf(b))
-#else
-#   define Float_Complex float complex
-#   define cfromreal(re) (re)
-#   define cfromimag(im) ((im)*I)
-#   define mulcc(a, b) ((a)*(b))
-#   define addcc(a, b) ((a)+(b))
-#   define subcc(a, b) ((a)-(b))
-#endif // _MSC_VER
+#define KEY_FFT_SIZE_DOWN         KEY_LEFT_BRACKET
+#define KEY_FFT_SIZE_UP           KEY_RIGHT_BRACKET
+#define KEY_FFT_HOP_DOWN          KEY_MINUS
+#define KEY_FFT_HOP_UP            KEY_EQUAL
+#define KEY_ANALYZER_ENGINE       KEY_E
+#define KEY_BANDS_SCALE           KEY_B
+#define KEY_BANDS_AGGREGATE       KEY_A
+#define KEY_WINDOW                KEY_N
+#define KEY_LOG_MODE              KEY_L
+#define KEY_INGEST_MODE           KEY_S
+#define KEY_LATENCY_DOWN          KEY_COMMA
+#define KEY_LATENCY_UP            KEY_PERIOD
+#define KEY_LAYOUT                KEY_O
+#define KEY_RENDER_BACKEND        KEY_G
+#define KEY_PALETTE               KEY_P
+#define KEY_BLOOM                 KEY_K
 
 // Struct Definitions
 typedef struct {
     char *file_path;
     Music music;
+    uint64_t content_hash; // See track_content_hash()
+    bool content_hashed;
+    drmp3_seek_point *mp3_seek_points; // See prefill_decode(), NULL until the first seek
+    drmp3_uint32 mp3_seek_points_count;
 } Track;
 
 typedef struct {
@@ -127,6 +222,15 @@ typedef struct {
     size_t capacity;
 } Tracks;
 
+// Hashes the file of a track on a thread of its own, see track_content_hash(). It only knows the
+// path, the tracks may move in memory meanwhile.
+typedef struct {
+    Thread *thread;              // NULL unless hashing
+    volatile uint32_t done;
+    const char *file_path;
+    uint64_t hash;
+} Track_Hasher;
+
 typedef struct {
     float lifetime;
 } Popup;
@@ -135,277 +239,2119 @@ typedef struct {
 #define PT_FIRST(pt) PT_GET((pt), 0)
 #define PT_LAST(pt) PT_GET((pt), (pt)->count - 1)
 
-#define POPUP_TRAY_CAPACITY 20
-typedef struct {
-    Popup items[POPUP_TRAY_CAPACITY];
-    size_t begin;
-    size_t count;
-    float slide;
-} Popup_Tray;
+#define POPUP_TRAY_CAPACITY 20
+typedef struct {
+    Popup items[POPUP_TRAY_CAPACITY];
+    size_t begin;
+    size_t count;
+    float slide;
+} Popup_Tray;
+
+typedef enum {
+    SIDE_LEFT,
+    SIDE_RIGHT,
+    SIDE_TOP,
+    SIDE_BOTTOM,
+} Side;
+
+typedef enum {
+    UI_ICON_FULLSCREEN,
+    UI_ICON_VOLUME,
+    UI_ICON_PLAY,
+    UI_ICON_RENDER,
+    UI_ICON_MICROPHONE,
+    COUNT_UI_ICONS,
+} UI_Icon;
+
+static_assert(COUNT_UI_ICONS == 5, "Amount of icons changed");
+static const char *icon_file_paths[COUNT_UI_ICONS] = {
+    [UI_ICON_FULLSCREEN] = "./resources/icons/fullscreen.png",
+    [UI_ICON_VOLUME]     = "./resources/icons/volume.png",
+    [UI_ICON_PLAY]       = "./resources/icons/play.png",
+    [UI_ICON_RENDER]     = "./resources/icons/render.png",
+    [UI_ICON_MICROPHONE] = "./resources/icons/microphone.png",
+};
+
+typedef enum {
+    // One big FFT squashed into the log bands
+    ANALYZER_ENGINE_FFT,
+    // Small FFTs over the octaves of the signal, see multires.h
+    ANALYZER_ENGINE_MULTIRES,
+    // A sliding DFT bin per band that only looks at the new samples, see sdft.h
+    ANALYZER_ENGINE_SDFT,
+    COUNT_ANALYZER_ENGINES,
+} Analyzer_Engine;
+
+static_assert(COUNT_ANALYZER_ENGINES == 3, "Amount of analyzer engines changed");
+static const char *analyzer_engine_names[COUNT_ANALYZER_ENGINES] = {
+    [ANALYZER_ENGINE_FFT]      = "FFT",
+    [ANALYZER_ENGINE_MULTIRES] = "Multi-resolution",
+    [ANALYZER_ENGINE_SDFT]     = "Sliding DFT",
+};
+
+// How fft_render() lays out the spectra of several streams
+typedef enum {
+    // One above the other, the first one at the top
+    LAYOUT_STACKED,
+    // All of them over the whole screen, every one in its own part of the color wheel
+    LAYOUT_OVERLAY,
+    COUNT_LAYOUTS,
+} Layout;
+
+static_assert(COUNT_LAYOUTS == 2, "Amount of layouts changed");
+static const char *layout_names[COUNT_LAYOUTS] = {
+    [LAYOUT_STACKED] = "Stacked",
+    [LAYOUT_OVERLAY] = "Overlay",
+};
+
+// How fft_render_spectrum() gets the bars on the screen
+typedef enum {
+    // A draw call per layer, the quads come from an instance per bar, see bars.vs
+    RENDER_BACKEND_INSTANCED,
+    // The bands go into a texture and a single fragment shader draws everything, see spectrum.fs
+    RENDER_BACKEND_TEXTURE,
+    // The CPU draws all of the spectra into an image on all of the processors, see raster.h.
+    // The rendering of the videos doesn't touch the GPU at all then.
+    RENDER_BACKEND_SOFTWARE,
+    COUNT_RENDER_BACKENDS,
+} Render_Backend;
+
+static_assert(COUNT_RENDER_BACKENDS == 3, "Amount of render backends changed");
+static const char *render_backend_names[COUNT_RENDER_BACKENDS] = {
+    [RENDER_BACKEND_INSTANCED] = "Instanced",
+    [RENDER_BACKEND_TEXTURE]   = "Spectrum texture",
+    [RENDER_BACKEND_SOFTWARE]  = "Software",
+};
+
+// The stems of a track (drums, bass, vocals, ...) are the audio files in the directory next to
+// it that is named after it: the stems of "music/song.mp3" are in "music/song.stems/". The track
+// itself is still what plays, but every stem becomes a stream of the analysis in place of the
+// ingest of the track. They are decoded into memory up front, in mono and at the sample rate of
+// the analysis, and fed into the rings along with the playback.
+typedef struct {
+    const char *track_path;      // The track they were looked up for, NULL for none
+    uint32_t sample_rate;        // What they were converted to
+    size_t count;
+    float *samples[STEMS_MAX];
+    size_t frames[STEMS_MAX];
+} Stems;
+
+// Decodes the stems of a track on a thread of its own, so the preview keeps going meanwhile.
+// Until they are done the analysis gets the track itself. See fft_follow_stems().
+typedef struct {
+    Thread *thread;              // NULL unless loading
+    volatile uint32_t done;
+    const char *track_path;      // What is being loaded
+    uint32_t sample_rate;
+    Stems stems;                 // Belongs to the thread until done
+} Stems_Loader;
+
+// Result of a single fft_analyze() handed over from the analysis thread to fft_render()
+typedef struct {
+    size_t m;
+    float *smooth;
+    float *smear;
+    float *center; // Center frequency of every band in Hz
+} Spectrum;
+
+// The layers of the bars in the order they are drawn. Passed to bars.vs as is.
+typedef enum {
+    BAR_LAYER_LINES,
+    BAR_LAYER_SMEARS,
+    BAR_LAYER_CIRCLES,
+} Bar_Layer;
+
+// What bars.vs gets per bar, see fft_render_spectrum(). The position of the bar comes from its
+// index.
+typedef struct {
+    float smooth;
+    float smear;
+    Color color;
+} Bar_Instance;
+
+// bars.vs combined with one of the fragment shaders
+typedef struct {
+    Shader shader;
+    int boundary_location;
+    int cell_width_location;
+    int layer_location;
+    int glow_scale_location;
+    int radius_location; // Only in circle.fs
+    int power_location;
+} Bars_Shader;
+
+typedef struct {
+    Shader shader;
+    int bands_location;
+    int count_location;
+    int area_location;
+    int boundary_location;
+    int palette_location;
+    int palette_from_location;
+    int palette_range_location;
+    int glow_scale_location;
+} Spectrum_Shader;
+
+// bloom_down.fs or bloom_up.fs
+typedef struct {
+    Shader shader;
+    int half_pixel_location;
+    int threshold_location; // Only in bloom_down.fs
+    int intensity_location; // Only in bloom_up.fs
+} Bloom_Shader;
+
+// Everything in the FFT Analyzer that depends on the FFT size. It's allocated for a
+// particular size and gets replaced as a whole when the size changes.
+typedef struct {
+    size_t size;
+    FFT_Real_Plan plan;
+    float *in_win;
+    Float_Complex *out_raw;
+    float *out_power;
+    float *out_log;
+    float *out_smooth;
+    float *out_smear;
+    Bands bands;
+    Multires multires;
+    uint64_t multires_head; // Position in the ring up to which the samples went into multires
+    bool multires_primed;   // Whether multires_head means anything
+    Sdft sdft;              // Laid out for the current bands, see fft_update_sdft()
+    Triple_Buffer spectra_tb;
+    Spectrum spectra[3];
+} Analyzer;
+
+// Offline rendering computes the bands of all of the video frames up front on a pool of
+// workers, see precompute_start(). The frames are split into blocks of
+// PRECOMPUTE_BLOCK_FRAMES and every block is analyzed from scratch, so the result does not
+// depend on the amount of workers. The blocks are dealt out round-robin: worker w gets
+// w, w + workers_count, w + 2*workers_count, ...
+typedef struct {
+    Thread *thread;
+    size_t index;
+    volatile uint32_t blocks_done; // Amount of the blocks of this worker that are in the buffer
+    Ring rings[ANALYSIS_STREAMS_MAX];
+    Decimator decimators[ANALYSIS_STREAMS_MAX];
+    Analyzer analyzers[ANALYSIS_STREAMS_MAX];
+    FFT_Batch batch; // Only with at least ANALYSIS_BATCH_MIN streams
+} Precompute_Worker;
+
+typedef struct {
+    float *bands;        // frames*streams*m normalized log powers, m per stream per frame
+    size_t frames;       // Amount of video frames until the analysis window is all silence
+    size_t chunk;        // Amount of audio frames per video frame
+    size_t decimation;
+    size_t streams;
+    size_t m;
+    Ingest_Mode ingest_mode;
+    size_t blocks;
+    Precompute_Worker *workers;
+    size_t workers_count;
+    volatile uint32_t quit;
+    bool keyed;           // Whether the track can be cached under `key`
+    Spectrogram_Key key;
+    Spectrogram cache;    // Open if the bands came from the cache. There are no workers then.
+} Precompute;
+
+// The software render backend splits the rows of the image into tiles of RASTER_TILE_ROWS and
+// deals them out round-robin like the blocks of Precompute_Worker, so the tops of the bars,
+// where most of the circles are, get spread over all of the workers. See fft_rasterize().
+typedef struct {
+    Thread *thread;
+    size_t index;
+    ma_event start;   // Signaled by fft_rasterize() when there is a frame to draw
+    ma_event done;    // Signaled by the worker when its share of the frame is drawn
+} Raster_Worker;
+
+typedef struct {
+    Raster_Image image;
+    size_t image_capacity;     // In pixels
+    Texture2D texture;         // The image for the preview, see fft_render_software()
+    Raster_Spectrum spectra[ANALYSIS_STREAMS_MAX];
+    size_t streams;
+    Palette_Color background;
+    Raster_Worker workers[RASTER_WORKERS_MAX];
+    size_t workers_count;      // 0 until raster_start()
+    volatile uint32_t quit;
+} Raster;
+
+typedef struct {
+    // Assets
+    Texture2D icon_textures[COUNT_UI_ICONS];
+
+    // Visualizer
+    Tracks tracks;
+    int current_track;
+    Font font;
+    Shader circle;
+    int circle_radius_location;
+    int circle_power_location;
+    Bars_Shader bars_flat;   // With the default fragment shader of raylib
+    Bars_Shader bars_circle; // With circle.fs
+    unsigned int bars_vao;
+    unsigned int bars_corners_vbo;
+    unsigned int bars_instances_vbo;
+    Bar_Instance *bars;      // Staging for bars_instances_vbo
+    size_t bars_capacity;
+    Spectrum_Shader spectrum;
+    Texture2D spectrum_texture; // Two rows of floats for spectrum.fs, at least m wide
+    Render_Backend render_backend;
+    // Copies of the built-in palettes followed by the themes of the user. The tables point in
+    // here, and unlike the built-in ones it survives the hot reloading.
+    Palette palettes[PALETTES_MAX];
+    size_t palettes_count;
+    size_t palette;
+    Palette_Table bar_colors[ANALYSIS_STREAMS_MAX]; // Of the spectrum of every stream
+    Texture2D palette_texture;                      // All of the current palette for spectrum.fs
+    bool bloom;
+    Bloom_Shader bloom_down;
+    Bloom_Shader bloom_up;
+    RenderTexture2D bloom_scene;                    // Of the size of the boundary
+    RenderTexture2D bloom_levels[BLOOM_LEVELS];     // Every one half the size of the previous one
+    Raster raster;
+    // Where the frame is being drawn, see begin_target() and begin_clip()
+    RenderTexture2D *target;                        // NULL for the screen
+    bool clipping;
+    Rectangle clip;
+    bool fullscreen;
+
+    // Renderer
+    bool rendering;
+    RenderTexture2D screen;
+    Wave wave;
+    float *wave_samples;
+    size_t wave_cursor;
+    FFMPEG *ffmpeg;
+    bool cancel_rendering;
+    Precompute precompute;
+
+    // FFT Analyzer
+    Ring rings[ANALYSIS_STREAMS_MAX];
+    // Belong to whoever is pushing into the rings, see fft_rings_lock()
+    Decimator decimators[ANALYSIS_STREAMS_MAX];
+    volatile uint64_t frames_fed; // Amount of audio frames ever pushed, before the decimation
+    Analyzer analyzers[ANALYSIS_STREAMS_MAX];
+    FFT_Batch batch; // Of the size of the analyzers, see fft_analyze_streams()
+    volatile uint32_t ingest_mode;
+    // Producer state like the decimators. Only changes while the analysis is stopped.
+    Stems stems;
+    volatile uint64_t stems_cursor; // Frame of the stems that goes into the rings next
+    Stems_Loader stems_loader;
+    Track_Hasher hasher;
+    Layout layout;
+    Window_Cache windows;
+    volatile uint32_t window_kind;
+    volatile uint32_t log_mode;
+    size_t fft_size_preview;
+    size_t fft_size_render;
+    volatile uint32_t fft_hop;
+    volatile uint32_t analyzer_engine;
+    volatile uint32_t bands_scale;
+    volatile uint32_t bands_aggregate;
+    volatile uint32_t sample_rate; // Of the audio coming in, see fft_set_sample_rate()
+    volatile uint32_t decimation;
+    uint32_t sample_rate_preview;
+    // The preview takes the bands of the current track from here if they are cached, see
+    // fft_follow_track()
+    Spectrogram preview_cache;
+    Spectrogram_Key preview_cache_key;
+    volatile uint32_t preview_frame;
+    // The audio callback keeps track of the position of the playback, see fft_playback_delay()
+    volatile uint32_t playback_latency; // Frames queued in the device, 0 for the microphone
+    volatile uint64_t playback_nanos;   // GetTime() of the latest callback in nanoseconds
+    volatile uint32_t latency_offset;   // Milliseconds as int32_t, positive delays the bars
+    double playback_burst_time;         // The rest is for the audio callback only
+    uint32_t playback_burst_frames;
+    volatile uint32_t rings_busy;       // See fft_rings_lock()
+
+    // Analysis Thread
+    Thread *analysis_thread;
+    volatile uint32_t analysis_quit;
+    volatile uint32_t analysis_asleep; // Waiting for the audio, the bars won't move until then
+    ma_event analysis_wakeup;
+
+#ifndef MUSIALIZER_ACT_ON_PRESS
+    uint64_t active_button_id;
+#endif // MUSIALIZER_ACT_ON_PRESS
+
+    Popup_Tray pt;
+
+    // Idle, see idle_update()
+    bool animating;     // Something on the screen moves on its own this frame
+    bool hidden;        // The window is minimized or hidden, nobody sees the preview
+    bool event_waiting; // EndDrawing() sleeps until there is an event
+
+    bool tooltip_show;
+    char tooltip_buffer[32];
+    Side tooltip_align;
+    Rectangle tooltip_element_boundary;
+
+#ifdef MUSIALIZER_MICROPHONE
+    // Microphone
+    bool capturing;
+    ma_device microphone;
+    drwav wav;
+    bool microphone_working;
+#endif // MUSIALIZER_MICROPHONE
+} Plug;
+
+static Plug *p = NULL;
+
+// Amount of streams the stems or the current ingest mode feed into the analyzers
+static size_t fft_streams(void) {
+    if (p->stems.count > 0) return p->stems.count;
+    return ingest_streams(atomic_u32_load(&p->ingest_mode));
+}
+
+// The latest spectrum of the stream published by fft_analyze()
+static Spectrum *fft_spectrum(size_t stream) {
+    Analyzer *a = &p->analyzers[stream];
+    return &a->spectra[triple_buffer_front(&a->spectra_tb)];
+}
+
+static bool fft_settled(void) {
+    float eps = 1e-3;
+    for (size_t stream = 0; stream < fft_streams(); ++stream) {
+        Spectrum *s = fft_spectrum(stream);
+        for (size_t i = 0; i < s->m; ++i) {
+            if (s->smooth[i] > eps || s->smear[i] > eps) return false;
+        }
+    }
+    return true;
+}
+
+static void analyzer_free(Analyzer *a) {
+    fft_real_plan_free(&a->plan);
+    multires_free(&a->multires);
+    sdft_free(&a->sdft);
+    bands_free(&a->bands);
+    free(a->in_win);
+    free(a->out_raw);
+    free(a->out_power);
+    free(a->out_log);
+    free(a->out_smooth);
+    free(a->out_smear);
+    for (size_t i = 0; i < NOB_ARRAY_LEN(a->spectra); ++i) {
+        free(a->spectra[i].smooth);
+        free(a->spectra[i].smear);
+        free(a->spectra[i].center);
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+static bool analyzer_init(Analyzer *a, size_t size) {
+    memset(a, 0, sizeof(*a));
+    a->size = size;
+    // NOTE: the amount of logarithmic bins is always less than size/2, so that's
+    // the upper bound for everything that fft_analyze() produces
+    bool ok = fft_real_plan_init(&a->plan, size);
+    ok = multires_init(&a->multires, size, MULTIRES_LEVEL_SIZE_DEFAULT) && ok;
+    a->in_win     = calloc(size, sizeof(*a->in_win));
+    a->out_raw    = calloc(size/2 + 1, sizeof(*a->out_raw));
+    a->out_power  = calloc(size/2 + 1, sizeof(*a->out_power));
+    a->out_log    = calloc(size/2, sizeof(*a->out_log));
+    a->out_smooth = calloc(size/2, sizeof(*a->out_smooth));
+    a->out_smear  = calloc(size/2, sizeof(*a->out_smear));
+    ok = ok && a->in_win && a->out_raw && a->out_power &&
+         a->out_log && a->out_smooth && a->out_smear;
+    for (size_t i = 0; i < NOB_ARRAY_LEN(a->spectra); ++i) {
+        a->spectra[i].smooth = calloc(size/2, sizeof(*a->spectra[i].smooth));
+        a->spectra[i].smear  = calloc(size/2, sizeof(*a->spectra[i].smear));
+        a->spectra[i].center = calloc(size/2, sizeof(*a->spectra[i].center));
+        ok = ok && a->spectra[i].smooth && a->spectra[i].smear && a->spectra[i].center;
+    }
+    if (!ok) {
+        analyzer_free(a);
+        return false;
+    }
+
+    triple_buffer_init(&a->spectra_tb);
+    return true;
+}
+
+static void analyzer_clean(Analyzer *a) {
+    size_t n = a->size;
+    memset(a->in_win, 0, n*sizeof(*a->in_win));
+    memset(a->out_raw, 0, (n/2 + 1)*sizeof(*a->out_raw));
+    memset(a->out_power, 0, (n/2 + 1)*sizeof(*a->out_power));
+    memset(a->out_log, 0, n/2*sizeof(*a->out_log));
+    memset(a->out_smooth, 0, n/2*sizeof(*a->out_smooth));
+    memset(a->out_smear, 0, n/2*sizeof(*a->out_smear));
+    for (size_t i = 0; i < NOB_ARRAY_LEN(a->spectra); ++i) {
+        a->spectra[i].m = 0;
+    }
+    a->multires_primed = false;
+    sdft_reset(&a->sdft);
+    triple_buffer_init(&a->spectra_tb);
+}
+
+// The rings of the preview take one producer at a time. That's normally the audio callback,
+// but a seek pushes the audio at the new position from the main thread, see fft_prefill().
+// Every push is short, so even the callback can afford to spin.
+static void fft_rings_lock(void) {
+    while (atomic_u32_exchange(&p->rings_busy, 1)) {}
+}
+
+static void fft_rings_unlock(void) {
+    atomic_u32_store(&p->rings_busy, 0);
+}
+
+// The audio callback keeps pushing into the rings meanwhile, so they are cleared under the lock
+static void fft_clean(void) {
+    fft_rings_lock();
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        ring_clear(&p->rings[stream]);
+    }
+    fft_rings_unlock();
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        analyzer_clean(&p->analyzers[stream]);
+    }
+}
+
+// Reallocates the FFT Analyzers for a different FFT size. Nobody else may be using the
+// analyzers at that moment, so stop the analysis thread first. If the new size can't be
+// allocated for every stream we keep the old one. In both cases the analyzers end up clean.
+static void fft_resize(size_t size) {
+    assert(FFT_SIZE_MIN <= size && size <= FFT_SIZE_MAX);
+    assert((size & (size - 1)) == 0);
+    if (p->analyzers[0].size != size) {
+        Analyzer fresh[ANALYSIS_STREAMS_MAX];
+        size_t count = 0;
+        while (count < ANALYSIS_STREAMS_MAX && analyzer_init(&fresh[count], size)) count += 1;
+        if (count == ANALYSIS_STREAMS_MAX) {
+            for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+                analyzer_free(&p->analyzers[stream]);
+                p->analyzers[stream] = fresh[stream];
+            }
+            // The streams can be analyzed one by one just as well, only slower
+            fft_batch_free(&p->batch);
+            if (!fft_batch_init(&p->batch, size, ANALYSIS_STREAMS_MAX)) {
+                TraceLog(LOG_WARNING, "FFT: could not allocate the batch for size %zu", size);
+            }
+            TraceLog(LOG_INFO, "FFT: size %zu", size);
+        } else {
+            while (count > 0) analyzer_free(&fresh[--count]);
+            TraceLog(LOG_ERROR, "FFT: could not allocate the analyzers for size %zu", size);
+        }
+    }
+    fft_clean();
+}
+
+static size_t fft_size_for_render(void) {
+    return p->fft_size_render ? p->fft_size_render : p->fft_size_preview;
+}
+
+// The audio of the rings is decimated by the factor that brings the sample rate down to
+// ANALYSIS_SAMPLE_RATE_MAX. The producer of the rings picks up the new factor with its next
+// push, see fft_push_frames().
+static void fft_set_sample_rate(uint32_t rate) {
+    atomic_u32_store(&p->sample_rate, rate);
+    atomic_u32_store(&p->decimation, decimator_factor(rate, ANALYSIS_SAMPLE_RATE_MAX));
+}
+
+// Sample rate of the samples in the rings
+static float fft_analysis_rate(void) {
+    return (float)atomic_u32_load(&p->sample_rate)/atomic_u32_load(&p->decimation);
+}
+
+// Undoes the changes start_rendering_track() made to the analyzer for the video
+static void fft_restore_preview(void) {
+    fft_set_sample_rate(p->sample_rate_preview);
+    fft_resize(p->fft_size_preview);
+}
+
+static void fft_select_kernels(void) {
+#if defined(MUSIALIZER_FFT_FORCE_SCALAR)
+    FFT_Kernels_Kind kind = FFT_KERNELS_SCALAR;
+#elif defined(MUSIALIZER_FFT_FORCE_SSE2)
+    FFT_Kernels_Kind kind = FFT_KERNELS_SSE2;
+#elif defined(MUSIALIZER_FFT_FORCE_AVX2)
+    FFT_Kernels_Kind kind = FFT_KERNELS_AVX2;
+#elif defined(MUSIALIZER_FFT_FORCE_NEON)
+    FFT_Kernels_Kind kind = FFT_KERNELS_NEON;
+#else
+    FFT_Kernels_Kind kind = fft_kernels_best();
+#endif
+    if (!fft_kernels_select(kind)) {
+        TraceLog(LOG_WARNING, "FFT: %s kernels are not supported on this machine", fft_kernels_name(kind));
+        fft_kernels_select(fft_kernels_best());
+    }
+    TraceLog(LOG_INFO, "FFT: using %s kernels", fft_kernels_name(fft_kernels_current()));
+}
+
+// Rebuilds the band map if the FFT size, the sample rate or the scale has changed since the
+// last time. Called by whoever is running fft_analyze(), so nobody else is using the map.
+static void fft_update_bands_at(Analyzer *a, float sample_rate) {
+    Bands_Scale scale = atomic_u32_load(&p->bands_scale);
+    Bands *b = &a->bands;
+    if (b->count > 0 && b->fft_size == a->size && b->sample_rate == sample_rate && b->scale == scale) return;
+
+    Bands fresh;
+    if (!bands_init(&fresh, a->size, sample_rate, scale, ANALYSIS_OCTAVE_DIVISIONS)) {
+        TraceLog(LOG_ERROR, "FFT: could not allocate the %s band map", bands_scale_name(scale));
+        return;
+    }
+    bands_free(b);
+    *b = fresh;
+}
+
+static void fft_update_bands(Analyzer *a) {
+    fft_update_bands_at(a, fft_analysis_rate());
+}
+
+// Lays the sliding DFT out for the current bands and window if it's not already. Windows that
+// are not a sum of cosines can't be applied to it, so those get Hann instead.
+static void fft_update_sdft(Analyzer *a, Window_Kind kind) {
+    const float *window;
+    size_t terms = window_cosine_terms(kind, &window);
+    if (terms == 0) terms = window_cosine_terms(WINDOW_HANN, &window);
+    if (sdft_matches(&a->sdft, &a->bands, window, terms)) return;
+
+    Sdft fresh;
+    if (!sdft_init(&fresh, &a->bands, window, terms)) {
+        // The old layout is no good for the new bands, so better no bars than garbage
+        TraceLog(LOG_ERROR, "FFT: could not allocate the sliding DFT");
+        sdft_free(&a->sdft);
+        return;
+    }
+    sdft_free(&a->sdft);
+    a->sdft = fresh;
+}
+
+// FFT Analysis
+// Copies the samples of the ring up to `head` into a->in_win, applying the window of the FFT
+// engine on the way, so they are only touched once
+static void fft_load_window(Analyzer *a, Ring *ring, uint64_t head) {
+    size_t n = a->size;
+    const float *window = window_cache_get(&p->windows, atomic_u32_load(&p->window_kind), n);
+    assert(window != NULL && "Buy more RAM lol");
+    const float *first;
+    size_t count = ring_view(ring, head - n, n, &first);
+    fft_window(first, window, a->in_win, count);
+    fft_window(ring->items, window + count, a->in_win + count, n - count);
+}
+
+// Turns what the engine has computed into the normalized log power of the bands in a->out_log.
+// Returns the amount of bands.
+static size_t fft_squash_bands(Analyzer *a, Analyzer_Engine engine) {
+    FFT_Log_Mode log_mode = atomic_u32_load(&p->log_mode);
+    Bands_Aggregate aggregate = atomic_u32_load(&p->bands_aggregate);
+    size_t m = a->bands.count;
+    if (engine == ANALYZER_ENGINE_MULTIRES) {
+        for (size_t i = 0; i < m; ++i) {
+            size_t q0 = a->bands.start[i];
+            size_t q1 = a->bands.end[i];
+            a->out_log[i] = aggregate == BANDS_AGGREGATE_RMS
+                ? multires_band_mean(&a->multires, q0, q1)
+                : multires_band(&a->multires, q0, q1);
+        }
+    } else if (engine == ANALYZER_ENGINE_SDFT) {
+        // There is exactly one bin per band, nothing to aggregate
+        size_t count = a->sdft.count;
+        sdft_power(&a->sdft, a->out_log);
+        memset(a->out_log + count, 0, (m - count)*sizeof(*a->out_log));
+        fft_log(a->out_log, a->out_log, m, log_mode);
+    } else {
+        // NOTE: aggregating the linear power first means the log runs once per band instead
+        // of once per bin
+        bands_aggregate(&a->bands, a->out_power, a->out_log, aggregate);
+        fft_log(a->out_log, a->out_log, m, log_mode);
+    }
+
+    // Quiet bands have negative log power. They are silence as far as we are concerned.
+    float max_amp = 1.0f;
+    for (size_t i = 0; i < m; ++i) {
+        if (!(a->out_log[i] > 0.0f)) a->out_log[i] = 0.0f;
+        if (max_amp < a->out_log[i]) max_amp = a->out_log[i];
+    }
+
+    // Normalize Frequencies to 0..1 range
+    for (size_t i = 0; i < m; ++i) {
+        a->out_log[i] /= max_amp;
+    }
+    return m;
+}
+
+// Computes the normalized log power of the bands from the samples of the ring up to `head`
+// into a->out_log. Returns the amount of bands. Doesn't touch anything but the analyzer, so
+// the render precompute runs it on many analyzers in parallel.
+static size_t fft_analyze_bands(Analyzer *a, Ring *ring, uint64_t head) {
+    size_t n = a->size;
+    Analyzer_Engine engine = atomic_u32_load(&p->analyzer_engine);
+    Window_Kind window_kind = atomic_u32_load(&p->window_kind);
+    FFT_Log_Mode log_mode = atomic_u32_load(&p->log_mode);
+    fft_update_bands(a);
+    switch (engine) {
+    case ANALYZER_ENGINE_FFT: {
+        fft_load_window(a, ring, head);
+        fft_real_execute(&a->plan, a->in_win, a->out_raw);
+        fft_power(a->out_raw, a->out_power, n/2);
+        a->multires_primed = false;
+    } break;
+
+    case ANALYZER_ENGINE_MULTIRES: {
+        // Only the samples multires has not seen yet. Start over if we've lost track of them.
+        uint64_t from = a->multires_head;
+        if (!a->multires_primed || head - from > n) {
+            multires_reset(&a->multires);
+            from = head - n;
+        }
+        const float *first;
+        size_t count = ring_view(ring, from, head - from, &first);
+        multires_push(&a->multires, first, count);
+        multires_push(&a->multires, ring->items, head - from - count);
+        a->multires_head = head;
+        a->multires_primed = true;
+        const float *window = window_cache_get(&p->windows, window_kind, a->multires.level_size);
+        assert(window != NULL && "Buy more RAM lol");
+        multires_execute(&a->multires, window, log_mode);
+    } break;
+
+    case ANALYZER_ENGINE_SDFT: {
+        fft_update_sdft(a, window_kind);
+        sdft_update(&a->sdft, ring, head);
+    } break;
+
+    default: NOB_UNREACHABLE("fft_analyze");
+    }
+
+    return fft_squash_bands(a, engine);
+}
+
+// fft_analyze_bands() of `streams` analyzers with the windows of their rings ending at heads[].
+// The FFT engine transforms the windows of all of the streams in one go on the batch if it's
+// there for the size, the rest is done stream by stream anyway.
+static size_t fft_analyze_streams(Analyzer as[], Ring rings[], FFT_Batch *batch, size_t streams, const uint64_t heads[]) {
+    size_t n = as[0].size;
+    Analyzer_Engine engine = atomic_u32_load(&p->analyzer_engine);
+    if (engine != ANALYZER_ENGINE_FFT || streams < ANALYSIS_BATCH_MIN || batch->plan.n != n || batch->streams < streams) {
+        size_t m = 0;
+        for (size_t stream = 0; stream < streams; ++stream) {
+            m = fft_analyze_bands(&as[stream], &rings[stream], heads[stream]);
+        }
+        return m;
+    }
+
+    const float *in[ANALYSIS_STREAMS_MAX];
+    Float_Complex *out[ANALYSIS_STREAMS_MAX];
+    for (size_t stream = 0; stream < streams; ++stream) {
+        Analyzer *a = &as[stream];
+        fft_update_bands(a);
+        fft_load_window(a, &rings[stream], heads[stream]);
+        in[stream] = a->in_win;
+        out[stream] = a->out_raw;
+    }
+    fft_batch_execute(batch, in, out, streams);
+    size_t m = 0;
+    for (size_t stream = 0; stream < streams; ++stream) {
+        Analyzer *a = &as[stream];
+        fft_power(a->out_raw, a->out_power, n/2);
+        a->multires_primed = false;
+        m = fft_squash_bands(a, engine);
+    }
+    return m;
+}
+
+// Moves the bars towards the first m values of a->out_log and publishes the spectrum. Unlike
+// the bands themselves this depends on every previous step, so it's always done in order.
+static void fft_smooth_bands(Analyzer *a, size_t m, float dt) {
+    // Smooth and Smear Values
+    float smoothness = 8;
+    float smearness = 3;
+    for (size_t i = 0; i < m; ++i) {
+        a->out_smooth[i] += (a->out_log[i] - a->out_smooth[i]) * smoothness * dt;
+        a->out_smear[i] += (a->out_smooth[i] - a->out_smear[i]) * smearness * dt;
+    }
+
+    Spectrum *s = &a->spectra[triple_buffer_back(&a->spectra_tb)];
+    s->m = m;
+    memcpy(s->smooth, a->out_smooth, m*sizeof(s->smooth[0]));
+    memcpy(s->smear, a->out_smear, m*sizeof(s->smear[0]));
+    memcpy(s->center, a->bands.center, m*sizeof(s->center[0]));
+    triple_buffer_publish(&a->spectra_tb);
+}
+
+// Analyzes the window of every stream that ends `delay` samples before the latest one
+static void fft_analyze(uint64_t delay, float dt) {
+    size_t streams = fft_streams();
+    uint64_t heads[ANALYSIS_STREAMS_MAX] = {0};
+    for (size_t stream = 0; stream < streams; ++stream) {
+        heads[stream] = atomic_u64_load(&p->rings[stream].head) - delay;
+    }
+    size_t m = fft_analyze_streams(p->analyzers, p->rings, &p->batch, streams, heads);
+    for (size_t stream = 0; stream < streams; ++stream) {
+        fft_smooth_bands(&p->analyzers[stream], m, dt);
+    }
+}
+
+// Amount of the latest samples in the rings that are not coming out of the speakers yet.
+// The device keeps playing between the callbacks, so the queue drains at the sample rate.
+static uint64_t fft_playback_delay(void) {
+    uint32_t latency = atomic_u32_load(&p->playback_latency);
+    // The microphone, or nothing has been played yet
+    if (latency == 0) return 0;
+    uint32_t rate = atomic_u32_load(&p->sample_rate);
+    int32_t offset_ms = (int32_t)atomic_u32_load(&p->latency_offset);
+    double since = GetTime() - atomic_u64_load(&p->playback_nanos)*1e-9;
+    double delay = (latency + (offset_ms/1000.0 - since)*rate)/atomic_u32_load(&p->decimation);
+    if (delay <= 0) return 0;
+    if (delay > LATENCY_MAX_FRAMES) return LATENCY_MAX_FRAMES;
+    return delay;
+}
+
+// Takes the bands of the preview out of the cache of the track at the frame the playback is
+// at instead of analyzing the ring. The cache is only opened and closed while nobody is
+// analyzing, see fft_follow_track().
+static void fft_analyze_preview(float dt) {
+    Spectrogram *sg = &p->preview_cache;
+    if (sg->file == NULL) {
+        fft_analyze(fft_playback_delay(), dt);
+        return;
+    }
+
+    size_t frame = atomic_u32_load(&p->preview_frame);
+    for (size_t stream = 0; stream < fft_streams(); ++stream) {
+        Analyzer *a = &p->analyzers[stream];
+        // The band map the cache was made with
+        uint32_t rate = sg->header->key.sample_rate;
+        fft_update_bands_at(a, (float)rate/decimator_factor(rate, ANALYSIS_SAMPLE_RATE_MAX));
+        size_t m = a->bands.count;
+        if (frame < sg->frames && stream < sg->streams) {
+            spectrogram_get(sg, frame, stream, a->out_log, m);
+        } else {
+            // Past the end of the track there is nothing but silence
+            memset(a->out_log, 0, m*sizeof(*a->out_log));
+        }
+        fft_smooth_bands(a, m, dt);
+    }
+}
+
+// Whether another fft_analyze() on the same input would not change anything visible
+static bool fft_converged(void) {
+    float eps = 1e-3;
+    for (size_t stream = 0; stream < fft_streams(); ++stream) {
+        Analyzer *a = &p->analyzers[stream];
+        for (size_t i = 0; i < a->bands.count; ++i) {
+            if (fabsf(a->out_log[i] - a->out_smooth[i]) > eps) return false;
+            if (fabsf(a->out_smooth[i] - a->out_smear[i]) > eps) return false;
+        }
+    }
+    return true;
+}
+
+// Snaps the measured sample rate to the closest standard one. Returns 0 if it's not close to any.
+static uint32_t analysis_standard_sample_rate(double measured) {
+    static const uint32_t standard[] = {8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(standard); ++i) {
+        if (fabs(measured - standard[i]) < standard[i]*0.03) return standard[i];
+    }
+    return 0;
+}
+
+// Analysis Thread
+// Runs fft_analyze() every time the playback moves by at least fft_hop samples. The position
+// of the playback is extrapolated between the callbacks (see fft_playback_delay()), so small
+// hops do get analyzed in between the device periods, up to ANALYSIS_FPS times a second. When
+// the audio stalls (pause, end of track) the thread keeps going at ANALYSIS_FPS until the bars
+// stop moving and then sleeps until the audio callback wakes it up. If the current track is
+// cached, a new frame of the cache takes the place of a new hop.
+// While the thread is running nobody else is allowed to touch the FFT Analyzer state.
+static void analysis_thread(void *arg) {
+    (void) arg;
+    uint64_t seen_head = atomic_u64_load(&p->rings[0].head);
+    uint64_t last_position = seen_head - fft_playback_delay();
+    double last_time = GetTime();
+    double audio_time = last_time;
+    // Measuring the sample rate of the device from the amount of audio arriving per second.
+    // The rings get the decimated audio, so it's counted before the decimation.
+    uint64_t rate_fed = atomic_u64_load(&p->frames_fed);
+    double rate_time = last_time;
+    uint32_t last_frame = atomic_u32_load(&p->preview_frame);
+    bool converged = false;
+    while (!atomic_u32_load(&p->analysis_quit)) {
+        uint64_t head = atomic_u64_load(&p->rings[0].head);
+        double now = GetTime();
+        if (head != seen_head) {
+            if (now - audio_time > 0.1) {
+                // The audio has been interrupted, the measurement starts over
+                rate_fed = atomic_u64_load(&p->frames_fed);
+                rate_time = now;
+            } else if (now - rate_time >= 2.0) {
+                uint64_t fed = atomic_u64_load(&p->frames_fed);
+                uint32_t rate = analysis_standard_sample_rate((fed - rate_fed)/(now - rate_time));
+                if (rate != 0 && rate != atomic_u32_load(&p->sample_rate)) {
+                    TraceLog(LOG_INFO, "ANALYSIS: sample rate %u", rate);
+                    fft_set_sample_rate(rate);
+                }
+                rate_fed = fed;
+                rate_time = now;
+            }
+            seen_head = head;
+            audio_time = now;
+        }
+
+        uint64_t delay = fft_playback_delay();
+        uint64_t position = head - delay;
+        bool fresh;
+        if (p->preview_cache.file != NULL) {
+            // A new frame of the cache instead of a new hop of the audio
+            uint32_t frame = atomic_u32_load(&p->preview_frame);
+            fresh = frame != last_frame;
+            last_frame = frame;
+        } else {
+            fresh = position - last_position >= atomic_u32_load(&p->fft_hop);
+        }
+        if (!fresh) {
+            if (converged) {
+                atomic_u32_store(&p->analysis_asleep, 1);
+                ma_event_wait(&p->analysis_wakeup);
+                atomic_u32_store(&p->analysis_asleep, 0);
+                continue;
+            }
+            // The audio is still coming, just not a whole hop of it yet
+            if (now - audio_time < 0.1) {
+                thread_sleep(1.0/ANALYSIS_FPS);
+                continue;
+            }
+        }
+        last_position = position;
+
+        float dt = now - last_time;
+        if (dt > 0.1f) dt = 0.1f;
+        last_time = now;
+
+        fft_analyze_preview(dt);
+        // The bars may have settled on a window that is still on its way to the speakers
+        converged = fft_converged() && delay == 0;
+
+        if (!fresh) thread_sleep(1.0/ANALYSIS_FPS - (GetTime() - now));
+    }
+}
+
+static void analysis_start(void) {
+    if (p->analysis_thread != NULL) return;
+    atomic_u32_store(&p->analysis_quit, 0);
+    atomic_u32_store(&p->analysis_asleep, 0);
+    p->analysis_thread = thread_start(analysis_thread, NULL);
+    if (p->analysis_thread == NULL) {
+        TraceLog(LOG_WARNING, "ANALYSIS: falling back to analyzing on the main thread");
+    }
+}
+
+static void analysis_stop(void) {
+    if (p->analysis_thread == NULL) return;
+    atomic_u32_store(&p->analysis_quit, 1);
+    ma_event_signal(&p->analysis_wakeup);
+    thread_join(p->analysis_thread);
+    p->analysis_thread = NULL;
+}
+
+static void fft_change_size_preview(size_t size) {
+    if (size < FFT_SIZE_MIN) size = FFT_SIZE_MIN;
+    if (size > FFT_SIZE_MAX) size = FFT_SIZE_MAX;
+    if (size == p->fft_size_preview) return;
+    p->fft_size_preview = size;
+    analysis_stop();
+    fft_resize(size);
+    analysis_start();
+}
+
+static void fft_change_engine(Analyzer_Engine engine) {
+    // Both engines are always allocated and produce the same layout of bands, so the analysis
+    // thread can just pick up the new one on the next fft_analyze()
+    atomic_u32_store(&p->analyzer_engine, engine);
+    TraceLog(LOG_INFO, "FFT: %s engine", analyzer_engine_names[engine]);
+}
+
+static void fft_change_bands_scale(Bands_Scale scale) {
+    // The analysis thread rebuilds the band map on its own when it notices the change
+    atomic_u32_store(&p->bands_scale, scale);
+    TraceLog(LOG_INFO, "FFT: %s bands", bands_scale_name(scale));
+}
+
+static void fft_change_bands_aggregate(Bands_Aggregate aggregate) {
+    atomic_u32_store(&p->bands_aggregate, aggregate);
+    TraceLog(LOG_INFO, "FFT: %s of the bands", bands_aggregate_name(aggregate));
+}
+
+static void fft_change_window(Window_Kind kind) {
+    atomic_u32_store(&p->window_kind, kind);
+    TraceLog(LOG_INFO, "FFT: %s window", window_name(kind));
+}
+
+static void fft_change_log_mode(FFT_Log_Mode mode) {
+    atomic_u32_store(&p->log_mode, mode);
+    TraceLog(LOG_INFO, "FFT: %s log", fft_log_mode_name(mode));
+}
+
+static void fft_change_ingest_mode(Ingest_Mode mode) {
+    // The streams change their meaning, so whatever the analyzers have seen so far is stale
+    analysis_stop();
+    atomic_u32_store(&p->ingest_mode, mode);
+    fft_clean();
+    analysis_start();
+    TraceLog(LOG_INFO, "FFT: %s ingest", ingest_mode_name(mode));
+}
+
+static void fft_change_latency_offset(int offset_ms) {
+    if (offset_ms < -LATENCY_OFFSET_MAX_MS) offset_ms = -LATENCY_OFFSET_MAX_MS;
+    if (offset_ms > LATENCY_OFFSET_MAX_MS) offset_ms = LATENCY_OFFSET_MAX_MS;
+    atomic_u32_store(&p->latency_offset, (uint32_t)offset_ms);
+    TraceLog(LOG_INFO, "FFT: latency offset %+d ms", offset_ms);
+}
+
+static void fft_change_hop(size_t hop) {
+    if (hop < FFT_HOP_MIN) hop = FFT_HOP_MIN;
+    if (hop > FFT_SIZE_MAX) hop = FFT_SIZE_MAX;
+    atomic_u32_store(&p->fft_hop, hop);
+    TraceLog(LOG_INFO, "FFT: hop %zu", hop);
+}
+
+static void fft_change_layout(Layout layout) {
+    // Only fft_render() looks at it, on the main thread
+    p->layout = layout;
+    TraceLog(LOG_INFO, "FFT: %s layout", layout_names[layout]);
+}
+
+// Draws the tiles of the worker into p->raster.image
+static void raster_draw_share(Raster_Worker *w) {
+    Raster *r = &p->raster;
+    size_t height = r->image.height;
+    for (size_t row = w->index*RASTER_TILE_ROWS; row < height; row += r->workers_count*RASTER_TILE_ROWS) {
+        size_t row_to = row + RASTER_TILE_ROWS;
+        raster_clear(&r->image, r->background, row, row_to);
+        for (size_t stream = 0; stream < r->streams; ++stream) {
+            raster_spectrum(&r->image, &r->spectra[stream], row, row_to);
+        }
+    }
+}
+
+static void raster_thread(void *arg) {
+    Raster *r = &p->raster;
+    Raster_Worker *w = arg;
+    for (;;) {
+        ma_event_wait(&w->start);
+        if (atomic_u32_load(&r->quit)) break;
+        raster_draw_share(w);
+        ma_event_signal(&w->done);
+    }
+}
+
+// Starts the workers of the software backend once, they stay parked on their start events in
+// between the frames until raster_stop(). The first share always goes to the main thread.
+static void raster_start(void) {
+    Raster *r = &p->raster;
+    if (r->workers_count > 0) return;
+    r->workers_count = thread_cpu_count();
+    if (r->workers_count > RASTER_WORKERS_MAX) r->workers_count = RASTER_WORKERS_MAX;
+    if (r->workers_count == 0) r->workers_count = 1;
+    atomic_u32_store(&r->quit, 0);
+    for (size_t i = 0; i < r->workers_count; ++i) {
+        Raster_Worker *w = &r->workers[i];
+        w->index = i;
+        w->thread = NULL;
+        if (i == 0) continue;
+        if (ma_event_init(&w->start) != MA_SUCCESS) {
+            TraceLog(LOG_WARNING, "FFT: could not start raster worker %zu", i);
+            continue;
+        }
+        if (ma_event_init(&w->done) != MA_SUCCESS) {
+            ma_event_uninit(&w->start);
+            TraceLog(LOG_WARNING, "FFT: could not start raster worker %zu", i);
+            continue;
+        }
+        w->thread = thread_start(raster_thread, w);
+        if (w->thread == NULL) {
+            ma_event_uninit(&w->start);
+            ma_event_uninit(&w->done);
+            TraceLog(LOG_WARNING, "FFT: could not start raster worker %zu", i);
+        }
+    }
+}
+
+static void raster_stop(void) {
+    Raster *r = &p->raster;
+    atomic_u32_store(&r->quit, 1);
+    for (size_t i = 0; i < r->workers_count; ++i) {
+        Raster_Worker *w = &r->workers[i];
+        if (w->thread == NULL) continue;
+        ma_event_signal(&w->start);
+        thread_join(w->thread);
+        ma_event_uninit(&w->start);
+        ma_event_uninit(&w->done);
+        w->thread = NULL;
+    }
+    r->workers_count = 0;
+}
+
+static void fft_change_render_backend(Render_Backend backend) {
+    // The rendering of the videos starts them again when it needs them
+    if (backend != RENDER_BACKEND_SOFTWARE) raster_stop();
+    p->render_backend = backend;
+    TraceLog(LOG_INFO, "FFT: %s render backend", render_backend_names[backend]);
+}
+
+// Samples the whole palette into p->palette_texture
+static void fft_update_palette_texture(void) {
+    Palette_Color colors[PALETTE_TEXTURE_SIZE];
+    for (size_t i = 0; i < PALETTE_TEXTURE_SIZE; ++i) {
+        colors[i] = palette_sample(&p->palettes[p->palette], (float)i/(PALETTE_TEXTURE_SIZE - 1));
+    }
+    if (p->palette_texture.id == 0) {
+        p->palette_texture = LoadTextureFromImage(CLITERAL(Image) {
+            .data = colors, .width = PALETTE_TEXTURE_SIZE, .height = 1, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        });
+        SetTextureFilter(p->palette_texture, TEXTURE_FILTER_BILINEAR);
+    } else {
+        UpdateTexture(p->palette_texture, colors);
+    }
+}
+
+static void fft_change_palette(size_t palette) {
+    p->palette = palette;
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        palette_table_reset(&p->bar_colors[stream]);
+    }
+    fft_update_palette_texture();
+    TraceLog(LOG_INFO, "FFT: %s palette", p->palettes[palette].name);
+}
+
+static void fft_change_bloom(bool bloom) {
+    p->bloom = bloom;
+    TraceLog(LOG_INFO, "FFT: bloom %s", bloom ? "on" : "off");
+}
+
+// With the bloom the circles and the smears are mostly there to be blurred, so they get smaller
+static float fft_glow_scale(void) {
+    return p->bloom ? BLOOM_GLOW_SCALE : 1.0f;
+}
+
+// The built-in palettes and the ones in THEMES_PATH if there is such a file
+static void palettes_load(void) {
+    p->palettes_count = 0;
+    for (size_t i = 0; i < palette_builtin_count() && p->palettes_count < PALETTES_MAX; ++i) {
+        p->palettes[p->palettes_count++] = *palette_builtin(i);
+    }
+    if (!FileExists(THEMES_PATH)) return;
+
+    char *text = LoadFileText(THEMES_PATH);
+    if (text == NULL) return;
+    size_t error_line = 0;
+    size_t count = palette_parse_themes(text, p->palettes + p->palettes_count, PALETTES_MAX - p->palettes_count, &error_line);
+    UnloadFileText(text);
+    if (error_line != 0) TraceLog(LOG_WARNING, "FFT: %s:%zu is not a theme", THEMES_PATH, error_line);
+    TraceLog(LOG_INFO, "FFT: loaded %zu themes from %s", count, THEMES_PATH);
+    p->palettes_count += count;
+}
+
+// FFT Rendering
+// (Re)allocates the instance buffer of bars.vs for at least `m` bars
+static void bars_reserve(size_t m) {
+    if (m <= p->bars_capacity) return;
+    size_t capacity = p->bars_capacity > 0 ? p->bars_capacity : 256;
+    while (capacity < m) capacity *= 2;
+    p->bars = realloc(p->bars, capacity*sizeof(*p->bars));
+    assert(p->bars != NULL && "Buy more RAM lol");
+    p->bars_capacity = capacity;
+
+    rlEnableVertexArray(p->bars_vao);
+    rlUnloadVertexBuffer(p->bars_instances_vbo);
+    p->bars_instances_vbo = rlLoadVertexBuffer(NULL, capacity*sizeof(*p->bars), true);
+    rlSetVertexAttribute(1, 2, RL_FLOAT, false, sizeof(Bar_Instance), (void*)offsetof(Bar_Instance, smooth));
+    rlEnableVertexAttribute(1);
+    rlSetVertexAttributeDivisor(1, 1);
+    rlSetVertexAttribute(2, 4, RL_UNSIGNED_BYTE, true, sizeof(Bar_Instance), (void*)offsetof(Bar_Instance, color));
+    rlEnableVertexAttribute(2);
+    rlSetVertexAttributeDivisor(2, 1);
+    rlDisableVertexArray();
+}
+
+static void bars_load(void) {
+    // Two triangles of the unit quad, see bars.vs
+    static const float corners[] = {0, 0, 0, 1, 1, 1, 0, 0, 1, 1, 1, 0};
+    p->bars_vao = rlLoadVertexArray();
+    rlEnableVertexArray(p->bars_vao);
+    p->bars_corners_vbo = rlLoadVertexBuffer(corners, sizeof(corners), false);
+    rlSetVertexAttribute(0, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(0);
+    rlDisableVertexArray();
+    bars_reserve(1);
+}
+
+static void bars_unload(void) {
+    rlUnloadVertexArray(p->bars_vao);
+    rlUnloadVertexBuffer(p->bars_corners_vbo);
+    rlUnloadVertexBuffer(p->bars_instances_vbo);
+    free(p->bars);
+    p->bars_vao = 0;
+    p->bars_corners_vbo = 0;
+    p->bars_instances_vbo = 0;
+    p->bars = NULL;
+    p->bars_capacity = 0;
+}
+
+static Bars_Shader bars_shader_load(const char *vs, const char *fs) {
+    Bars_Shader bs = {0};
+    bs.shader = LoadShaderFromMemory(vs, fs);
+    bs.boundary_location = GetShaderLocation(bs.shader, "boundary");
+    bs.cell_width_location = GetShaderLocation(bs.shader, "cellWidth");
+    bs.layer_location = GetShaderLocation(bs.shader, "layer");
+    bs.glow_scale_location = GetShaderLocation(bs.shader, "glowScale");
+    bs.radius_location = GetShaderLocation(bs.shader, "radius");
+    bs.power_location = GetShaderLocation(bs.shader, "power");
+    return bs;
+}
+
+// Draws a layer of the first `m` bars in p->bars, which are already uploaded
+static void bars_draw_layer(const Bars_Shader *bs, Bar_Layer layer, Rectangle boundary, size_t m, float radius, float power) {
+    float cell_width = boundary.width / m;
+    SetShaderValueMatrix(bs->shader, bs->shader.locs[SHADER_LOC_MATRIX_MVP], MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+    SetShaderValue(bs->shader, bs->shader.locs[SHADER_LOC_COLOR_DIFFUSE], (float[4]){1.0f, 1.0f, 1.0f, 1.0f}, SHADER_UNIFORM_VEC4);
+    SetShaderValue(bs->shader, bs->boundary_location, (float[4]){boundary.x, boundary.y, boundary.width, boundary.height}, SHADER_UNIFORM_VEC4);
+    SetShaderValue(bs->shader, bs->cell_width_location, &cell_width, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(bs->shader, bs->layer_location, (int[1]){layer}, SHADER_UNIFORM_INT);
+    SetShaderValue(bs->shader, bs->glow_scale_location, (float[1]){fft_glow_scale()}, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(bs->shader, bs->radius_location, &radius, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(bs->shader, bs->power_location, &power, SHADER_UNIFORM_FLOAT);
+    rlActiveTextureSlot(0);
+    rlEnableTexture(rlGetTextureIdDefault());
+    rlEnableVertexArray(p->bars_vao);
+    rlDrawVertexArrayInstanced(0, 6, m);
+    rlDisableVertexArray();
+    rlDisableTexture();
+    rlDisableShader();
+}
+
+// The bars, the smears and the circles are a draw call each, bars.vs builds their quads out
+// of a single buffer of Bar_Instance
+static void fft_render_spectrum_instanced(Spectrum *s, Rectangle boundary, const Palette_Color colors[]) {
+    size_t m = s->m;
+    bars_reserve(m);
+    for (size_t i = 0; i < m; ++i) {
+        p->bars[i] = CLITERAL(Bar_Instance) {
+            .smooth = s->smooth[i],
+            .smear = s->smear[i],
+            .color = {colors[i].r, colors[i].g, colors[i].b, colors[i].a},
+        };
+    }
+
+    // Whatever raylib has batched so far goes below the bars
+    rlDrawRenderBatchActive();
+    rlUpdateVertexBuffer(p->bars_instances_vbo, p->bars, m*sizeof(*p->bars), 0);
+    bars_draw_layer(&p->bars_flat, BAR_LAYER_LINES, boundary, m, 0.0f, 0.0f);
+    bars_draw_layer(&p->bars_circle, BAR_LAYER_SMEARS, boundary, m, 0.3f, 3.0f);
+    bars_draw_layer(&p->bars_circle, BAR_LAYER_CIRCLES, boundary, m, 0.07f, 5.0f);
+}
+
+static Spectrum_Shader spectrum_shader_load(const char *fs) {
+    Spectrum_Shader ss = {0};
+    ss.shader = LoadShaderFromMemory(NULL, fs);
+    ss.bands_location = GetShaderLocation(ss.shader, "bands");
+    ss.count_location = GetShaderLocation(ss.shader, "count");
+    ss.area_location = GetShaderLocation(ss.shader, "area");
+    ss.boundary_location = GetShaderLocation(ss.shader, "boundary");
+    ss.palette_location = GetShaderLocation(ss.shader, "palette");
+    ss.palette_from_location = GetShaderLocation(ss.shader, "paletteFrom");
+    ss.palette_range_location = GetShaderLocation(ss.shader, "paletteRange");
+    ss.glow_scale_location = GetShaderLocation(ss.shader, "glowScale");
+    return ss;
+}
+
+// The smoothed and the smeared values go into the two rows of p->spectrum_texture and
+// spectrum.fs draws everything in one pass over the boundary. The work on the CPU is the
+// upload of the two rows, no matter how many bands there are.
+static void fft_render_spectrum_texture(Spectrum *s, Rectangle boundary, float palette_from, float palette_range) {
+    size_t m = s->m;
+    if ((size_t)p->spectrum_texture.width < m) {
+        int width = p->spectrum_texture.width > 0 ? p->spectrum_texture.width : 256;
+        while ((size_t)width < m) width *= 2;
+        if (p->spectrum_texture.id != 0) UnloadTexture(p->spectrum_texture);
+        p->spectrum_texture = LoadTextureFromImage(CLITERAL(Image) {
+            .data = NULL, .width = width, .height = 2, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R32,
+        });
+    }
+    UpdateTextureRec(p->spectrum_texture, CLITERAL(Rectangle) {0, 0, m, 1}, s->smooth);
+    UpdateTextureRec(p->spectrum_texture, CLITERAL(Rectangle) {0, 1, m, 1}, s->smear);
+
+    // The circles reach up to 6 cells out of the boundary
+    float margin = 6*fft_glow_scale()*boundary.width/m;
+    Rectangle area = {
+        boundary.x - margin,
+        boundary.y - margin,
+        boundary.width + 2*margin,
+        boundary.height + 2*margin,
+    };
+    const Spectrum_Shader *ss = &p->spectrum;
+    SetShaderValue(ss->shader, ss->count_location, (int[1]){m}, SHADER_UNIFORM_INT);
+    SetShaderValue(ss->shader, ss->area_location, (float[4]){area.x, area.y, area.width, area.height}, SHADER_UNIFORM_VEC4);
+    SetShaderValue(ss->shader, ss->boundary_location, (float[4]){boundary.x, boundary.y, boundary.width, boundary.height}, SHADER_UNIFORM_VEC4);
+    SetShaderValue(ss->shader, ss->palette_from_location, &palette_from, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(ss->shader, ss->palette_range_location, &palette_range, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(ss->shader, ss->glow_scale_location, (float[1]){fft_glow_scale()}, SHADER_UNIFORM_FLOAT);
+
+    // spectrum.fs blends all of the layers itself, so it comes out premultiplied
+    Texture2D texture = { rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+    BeginShaderMode(ss->shader);
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    // NOTE: Both of the modes above flush the batch of raylib, which forgets the extra textures,
+    // so this has to come after them
+    SetShaderValueTexture(ss->shader, ss->bands_location, p->spectrum_texture);
+    SetShaderValueTexture(ss->shader, ss->palette_location, p->palette_texture);
+    DrawTexturePro(texture, CLITERAL(Rectangle) {0, 0, 1, 1}, area, CLITERAL(Vector2) {0}, 0, WHITE);
+    EndBlendMode();
+    EndShaderMode();
+}
+
+// The colors of the bands go over [palette_from, palette_from + palette_range) of the current
+// palette, where 1 is all of it
+static void fft_render_spectrum(size_t stream, Rectangle boundary, float palette_from, float palette_range) {
+    Spectrum *s = fft_spectrum(stream);
+    if (s->m == 0) return;
+    switch (p->render_backend) {
+    case RENDER_BACKEND_INSTANCED: {
+        const Palette_Color *colors = palette_table_update(&p->bar_colors[stream], &p->palettes[p->palette], s->m, palette_from, palette_range);
+        fft_render_spectrum_instanced(s, boundary, colors);
+    } break;
+    case RENDER_BACKEND_TEXTURE:   fft_render_spectrum_texture(s, boundary, palette_from, palette_range); break;
+    default: NOB_UNREACHABLE("fft_render_spectrum");
+    }
+}
+
+// Where the spectrum of the stream goes according to p->layout, and its part of the palette
+static Rectangle fft_layout(size_t stream, size_t streams, Rectangle boundary, float *palette_from, float *palette_range) {
+    switch (p->layout) {
+    case LAYOUT_STACKED: {
+        float height = boundary.height/streams;
+        *palette_from = 0.0f;
+        *palette_range = 1.0f;
+        return CLITERAL(Rectangle) {boundary.x, boundary.y + stream*height, boundary.width, height};
+    }
+
+    case LAYOUT_OVERLAY: {
+        *palette_from = (float)stream/streams;
+        *palette_range = 1.0f/streams;
+        return boundary;
+    }
+
+    default: NOB_UNREACHABLE("fft_layout");
+    }
+}
+
+// Draws the spectra of all of the streams over the background into p->raster.image of the given
+// size, laid out within the boundary in the coordinates of the image. The workers of
+// raster_start() get woken up for the frame and the main thread waits for them while it does the
+// share of the first one, and of the ones that could not be started.
+static void fft_rasterize(size_t width, size_t height, Rectangle boundary, Color background, float glow_scale) {
+    Raster *r = &p->raster;
+    if (width*height > r->image_capacity) {
+        r->image.pixels = realloc(r->image.pixels, width*height*4);
+        assert(r->image.pixels != NULL && "Buy more RAM lol");
+        r->image_capacity = width*height;
+    }
+    r->image.width = width;
+    r->image.height = height;
+    r->background = CLITERAL(Palette_Color) {background.r, background.g, background.b, background.a};
+
+    r->streams = fft_streams();
+    for (size_t stream = 0; stream < r->streams; ++stream) {
+        Spectrum *s = fft_spectrum(stream);
+        float palette_from, palette_range;
+        Rectangle rect = fft_layout(stream, r->streams, boundary, &palette_from, &palette_range);
+        r->spectra[stream] = CLITERAL(Raster_Spectrum) {
+            .m = s->m,
+            .smooth = s->smooth,
+            .smear = s->smear,
+            .colors = palette_table_update(&p->bar_colors[stream], &p->palettes[p->palette], s->m, palette_from, palette_range),
+            .x = rect.x, .y = rect.y, .width = rect.width, .height = rect.height,
+            .glow_scale = glow_scale,
+        };
+    }
+
+    raster_start();
+    for (size_t i = 0; i < r->workers_count; ++i) {
+        if (r->workers[i].thread != NULL) ma_event_signal(&r->workers[i].start);
+    }
+    for (size_t i = 0; i < r->workers_count; ++i) {
+        if (r->workers[i].thread == NULL) raster_draw_share(&r->workers[i]);
+    }
+    for (size_t i = 0; i < r->workers_count; ++i) {
+        if (r->workers[i].thread != NULL) ma_event_wait(&r->workers[i].done);
+    }
+}
+
+// The software backend in the preview. The spectra are rasterized into a transparent image of
+// the boundary plus the reach of the circles, which is uploaded and drawn premultiplied, the
+// same way spectrum.fs comes out.
+static void fft_render_software(Rectangle boundary) {
+    Spectrum *s = fft_spectrum(0);
+    if (s->m == 0) return;
+    float margin = ceilf(6*fft_glow_scale()*boundary.width/s->m);
+    int width = boundary.width + 2*margin;
+    int height = boundary.height + 2*margin;
+    if (width <= 0 || height <= 0) return;
+
+    fft_rasterize(width, height, CLITERAL(Rectangle) {margin, margin, boundary.width, boundary.height}, BLANK, fft_glow_scale());
+    Raster *r = &p->raster;
+    if (r->texture.width != width || r->texture.height != height) {
+        if (r->texture.id != 0) UnloadTexture(r->texture);
+        r->texture = LoadTextureFromImage(CLITERAL(Image) {
+            .data = NULL, .width = width, .height = height, .mipmaps = 1, .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8,
+        });
+    }
+    UpdateTexture(r->texture, r->image.pixels);
+
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    DrawTextureV(r->texture, CLITERAL(Vector2) {boundary.x - margin, boundary.y - margin}, WHITE);
+    EndBlendMode();
+}
+
+// Lays the spectra of all of the streams out according to p->layout
+static void fft_render_spectra(Rectangle boundary) {
+    if (p->render_backend == RENDER_BACKEND_SOFTWARE) {
+        fft_render_software(boundary);
+        return;
+    }
+    size_t streams = fft_streams();
+    for (size_t stream = 0; stream < streams; ++stream) {
+        float palette_from, palette_range;
+        Rectangle rect = fft_layout(stream, streams, boundary, &palette_from, &palette_range);
+        fft_render_spectrum(stream, rect, palette_from, palette_range);
+    }
+}
+
+// BeginTextureMode() and BeginScissorMode() that remember what they are doing. fft_render_bloom()
+// draws into textures of its own and has to get back to wherever the frame was being drawn.
+static void begin_target(RenderTexture2D *target) {
+    p->target = target;
+    BeginTextureMode(*target);
+}
+
+static void end_target(void) {
+    p->target = NULL;
+    EndTextureMode();
+}
+
+static void begin_clip(Rectangle clip) {
+    p->clipping = true;
+    p->clip = clip;
+    BeginScissorMode(clip.x, clip.y, clip.width, clip.height);
+}
+
+static void end_clip(void) {
+    p->clipping = false;
+    EndScissorMode();
+}
+
+static void restore_target(void) {
+    if (p->target != NULL) BeginTextureMode(*p->target);
+    else EndTextureMode();
+    if (p->clipping) BeginScissorMode(p->clip.x, p->clip.y, p->clip.width, p->clip.height);
+}
+
+static Bloom_Shader bloom_shader_load(const char *fs) {
+    Bloom_Shader bs = {0};
+    bs.shader = LoadShaderFromMemory(NULL, fs);
+    bs.half_pixel_location = GetShaderLocation(bs.shader, "halfPixel");
+    bs.threshold_location = GetShaderLocation(bs.shader, "threshold");
+    bs.intensity_location = GetShaderLocation(bs.shader, "intensity");
+    return bs;
+}
+
+static void bloom_unload(void) {
+    if (p->bloom_scene.id != 0) UnloadRenderTexture(p->bloom_scene);
+    p->bloom_scene = CLITERAL(RenderTexture2D) {0};
+    for (size_t i = 0; i < BLOOM_LEVELS; ++i) {
+        if (p->bloom_levels[i].id != 0) UnloadRenderTexture(p->bloom_levels[i]);
+        p->bloom_levels[i] = CLITERAL(RenderTexture2D) {0};
+    }
+}
+
+static RenderTexture2D bloom_load_target(int width, int height) {
+    RenderTexture2D target = LoadRenderTexture(width > 0 ? width : 1, height > 0 ? height : 1);
+    SetTextureFilter(target.texture, TEXTURE_FILTER_BILINEAR);
+    SetTextureWrap(target.texture, TEXTURE_WRAP_CLAMP);
+    return target;
+}
+
+static void bloom_resize(int width, int height) {
+    if (p->bloom_scene.texture.width == width && p->bloom_scene.texture.height == height) return;
+    bloom_unload();
+    p->bloom_scene = bloom_load_target(width, height);
+    for (size_t i = 0; i < BLOOM_LEVELS; ++i) {
+        p->bloom_levels[i] = bloom_load_target(width >> (i + 1), height >> (i + 1));
+    }
+}
+
+// Draws all of the render texture `from` into `dest` through the bloom shader. Render textures
+// are upside down, hence the negative height.
+static void bloom_pass(const Bloom_Shader *bs, RenderTexture2D from, Rectangle dest, float threshold, float intensity) {
+    BeginShaderMode(bs->shader);
+    SetShaderValue(bs->shader, bs->half_pixel_location, (float[2]){0.5f/dest.width, 0.5f/dest.height}, SHADER_UNIFORM_VEC2);
+    SetShaderValue(bs->shader, bs->threshold_location, &threshold, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(bs->shader, bs->intensity_location, &intensity, SHADER_UNIFORM_FLOAT);
+    Rectangle source = {0, 0, from.texture.width, -from.texture.height};
+    DrawTexturePro(from.texture, source, dest, CLITERAL(Vector2) {0}, 0, WHITE);
+    EndShaderMode();
+}
+
+// The spectra go into p->bloom_scene with the small circles and smears of fft_glow_scale(), then
+// the bright parts of it are blurred down a chain of textures that halve in size every time and
+// added back up on the way up. The cost depends on the size of the boundary, not on the amount
+// or the size of the circles. Unlike the circles on their own the glow ends at the boundary.
+static void fft_render_bloom(Rectangle boundary) {
+    int width = boundary.width;
+    int height = boundary.height;
+    if (width <= 0 || height <= 0) return;
+    bloom_resize(width, height);
+    // The clipping is in the coordinates of the target, it would cut into the textures
+    if (p->clipping) EndScissorMode();
+
+    BeginTextureMode(p->bloom_scene);
+    ClearBackground(COLOR_BACKGROUND);
+    fft_render_spectra(CLITERAL(Rectangle) {0, 0, width, height});
+    EndTextureMode();
+
+    RenderTexture2D from = p->bloom_scene;
+    for (size_t i = 0; i < BLOOM_LEVELS; ++i) {
+        RenderTexture2D to = p->bloom_levels[i];
+        BeginTextureMode(to);
+        bloom_pass(&p->bloom_down, from, CLITERAL(Rectangle) {0, 0, to.texture.width, to.texture.height}, i == 0 ? BLOOM_THRESHOLD : 0.0f, 1.0f);
+        EndTextureMode();
+        from = to;
+    }
+    for (size_t i = BLOOM_LEVELS - 1; i > 0; --i) {
+        RenderTexture2D to = p->bloom_levels[i - 1];
+        BeginTextureMode(to);
+        BeginBlendMode(BLEND_ADDITIVE);
+        bloom_pass(&p->bloom_up, p->bloom_levels[i], CLITERAL(Rectangle) {0, 0, to.texture.width, to.texture.height}, 0.0f, 1.0f);
+        EndBlendMode();
+        EndTextureMode();
+    }
+
+    // The scene is over the background already, but the alpha blending left it translucent in
+    // places, so it replaces whatever is under it
+    restore_target();
+    Rectangle source = {0, 0, width, -height};
+    rlSetBlendFactors(RL_ONE, RL_ZERO, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM);
+    DrawTexturePro(p->bloom_scene.texture, source, boundary, CLITERAL(Vector2) {0}, 0, WHITE);
+    EndBlendMode();
+    BeginBlendMode(BLEND_ADDITIVE);
+    bloom_pass(&p->bloom_up, p->bloom_levels[0], boundary, 0.0f, BLOOM_INTENSITY);
+    EndBlendMode();
+}
+
+static void fft_render(Rectangle boundary) {
+    // Nobody can see the preview, but the videos are drawn into p->screen
+    if (p->hidden && p->target == NULL) return;
+    if (p->bloom) fft_render_bloom(boundary);
+    else fft_render_spectra(boundary);
+}
+
+// Splits the interleaved frames into the streams of the ingest mode, decimates them and
+// appends them to their rings. Runs on the audio thread, so the scratch space is on the stack.
+static void fft_push_frames_into(Ring rings[], Decimator decimators[], Ingest_Mode mode, const float *frames, size_t count, size_t channels) {
+    size_t streams = ingest_streams(mode);
+    float scratch[ANALYSIS_STREAMS_MAX][512];
+    float *out[ANALYSIS_STREAMS_MAX];
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) out[stream] = scratch[stream];
+    while (count > 0) {
+        size_t n = count < NOB_ARRAY_LEN(scratch[0]) ? count : NOB_ARRAY_LEN(scratch[0]);
+        ingest_frames(mode, frames, n, channels, out);
+        for (size_t stream = 0; stream < streams; ++stream) {
+            size_t kept = decimator_process(&decimators[stream], scratch[stream], n, scratch[stream]);
+            ring_push(&rings[stream], scratch[stream], kept);
+        }
+        frames += n*channels;
+        count -= n;
+    }
+}
+
+static void fft_push_silence_into(Ring rings[], Decimator decimators[], Ingest_Mode mode, size_t count) {
+    for (size_t stream = 0; stream < ingest_streams(mode); ++stream) {
+        Decimator *d = &decimators[stream];
+        if (d->factor == 1) {
+            ring_push_silence(&rings[stream], count);
+            continue;
+        }
+        // The tail of the filter still rings out of the silence
+        float silence[512] = {0};
+        float out[512];
+        for (size_t left = count; left > 0;) {
+            size_t n = left < NOB_ARRAY_LEN(silence) ? left : NOB_ARRAY_LEN(silence);
+            ring_push(&rings[stream], out, decimator_process(d, silence, n, out));
+            left -= n;
+        }
+    }
+}
+
+// Pushes the frames [from, from + count) of every stem into the ring of its stream. The
+// frames outside of a stem are silence.
+static void fft_push_stems_into(const Stems *stems, Ring rings[], Decimator decimators[], int64_t from, size_t count) {
+    for (size_t stem = 0; stem < stems->count; ++stem) {
+        Ring *ring = &rings[stem];
+        Decimator *decimator = &decimators[stem];
+        int64_t frames = stems->frames[stem];
+        int64_t at = from;
+        size_t left = count;
+        if (at < 0) {
+            size_t k = (uint64_t)-at < left ? (size_t)-at : left;
+            fft_push_silence_into(ring, decimator, INGEST_MONO, k);
+            at += k;
+            left -= k;
+        }
+        if (left > 0 && at < frames) {
+            size_t k = (uint64_t)(frames - at) < left ? (size_t)(frames - at) : left;
+            fft_push_frames_into(ring, decimator, INGEST_MONO, stems->samples[stem] + at, k, 1);
+            at += k;
+            left -= k;
+        }
+        fft_push_silence_into(ring, decimator, INGEST_MONO, left);
+    }
+}
+
+// Takes the rings for a push. The decimators follow the sample rate from here, so they only
+// ever change under the lock.
+static void fft_rings_begin_push(void) {
+    fft_rings_lock();
+    size_t factor = atomic_u32_load(&p->decimation);
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        if (p->decimators[stream].factor != factor) decimator_init(&p->decimators[stream], factor);
+    }
+}
+
+// With the stems loaded whatever is being pushed only tells how far the playback went. The
+// stems at the same position go into the rings instead.
+static void fft_push_stems(size_t count) {
+    uint64_t cursor = atomic_u64_load(&p->stems_cursor);
+    fft_push_stems_into(&p->stems, p->rings, p->decimators, cursor, count);
+    atomic_u64_store(&p->stems_cursor, cursor + count);
+}
+
+static void fft_push_frames(const float *frames, size_t count, size_t channels) {
+    fft_rings_begin_push();
+    if (p->stems.count > 0) {
+        fft_push_stems(count);
+    } else {
+        fft_push_frames_into(p->rings, p->decimators, atomic_u32_load(&p->ingest_mode), frames, count, channels);
+    }
+    atomic_u64_store(&p->frames_fed, atomic_u64_load(&p->frames_fed) + count);
+    fft_rings_unlock();
+}
+
+static void fft_push_silence(size_t count) {
+    fft_rings_begin_push();
+    if (p->stems.count > 0) {
+        fft_push_stems(count);
+    } else {
+        fft_push_silence_into(p->rings, p->decimators, atomic_u32_load(&p->ingest_mode), count);
+    }
+    atomic_u64_store(&p->frames_fed, atomic_u64_load(&p->frames_fed) + count);
+    fft_rings_unlock();
+}
+
+// Stems
+static void stems_free(Stems *stems) {
+    for (size_t stem = 0; stem < stems->count; ++stem) {
+        UnloadWaveSamples(stems->samples[stem]);
+    }
+    memset(stems, 0, sizeof(*stems));
+}
+
+static int stems_compare_paths(const void *a, const void *b) {
+    return strcmp(*(const char *const*)a, *(const char *const*)b);
+}
+
+// Looks up and decodes the stems of the track, in the order of their file names. A track
+// without the stems directory just gets no stems.
+static void stems_load(Stems *stems, const char *track_path, uint32_t sample_rate) {
+    memset(stems, 0, sizeof(*stems));
+    stems->track_path = track_path;
+    stems->sample_rate = sample_rate;
+    if (track_path == NULL) return;
+
+    char dir[512];
+    snprintf(dir, sizeof(dir), "%s/%s%s", GetDirectoryPath(track_path), GetFileNameWithoutExt(track_path), STEMS_DIR_SUFFIX);
+    if (!DirectoryExists(dir)) return;
+
+    FilePathList files = LoadDirectoryFilesEx(dir, STEMS_EXTENSIONS, false);
+    qsort(files.paths, files.count, sizeof(*files.paths), stems_compare_paths);
+    if (files.count > STEMS_MAX) {
+        TraceLog(LOG_WARNING, "ANALYSIS: only the first %d of the %u stems in %s are analyzed", STEMS_MAX, files.count, dir);
+    }
+    for (size_t i = 0; i < files.count && stems->count < STEMS_MAX; ++i) {
+        Wave wave = LoadWave(files.paths[i]);
+        if (!IsWaveReady(wave)) {
+            TraceLog(LOG_WARNING, "ANALYSIS: could not load the stem %s", files.paths[i]);
+            continue;
+        }
+        // 32 bits means floats
+        WaveFormat(&wave, sample_rate, 32, 1);
+        stems->samples[stems->count] = LoadWaveSamples(wave);
+        stems->frames[stems->count] = wave.frameCount;
+        stems->count += 1;
+        UnloadWave(wave);
+    }
+    UnloadDirectoryFiles(files);
+    if (stems->count > 0) {
+        TraceLog(LOG_INFO, "ANALYSIS: %zu stems of %s at %u Hz", stems->count, track_path, sample_rate);
+    }
+}
+
+static void stems_loader_thread(void *arg) {
+    Stems_Loader *l = arg;
+    stems_load(&l->stems, l->track_path, l->sample_rate);
+    atomic_u32_store(&l->done, 1);
+}
 
-typedef enum {
-    SIDE_LEFT,
-    SIDE_RIGHT,
-    SIDE_TOP,
-    SIDE_BOTTOM,
-} Side;
+// Replaces the stems the analysis is fed with. The old ones may be in the middle of being pushed
+// by the audio callback, so they are swapped under the lock. The streams change their meaning,
+// so the analyzers start over.
+static void fft_swap_stems(Stems fresh) {
+    if (fresh.count == 0 && p->stems.count == 0) {
+        // Nothing changes for the analysis
+        p->stems = fresh;
+        return;
+    }
 
-typedef enum {
-    UI_ICON_FULLSCREEN,
-    UI_ICON_VOLUME,
-    UI_ICON_PLAY,
-    UI_ICON_RENDER,
-    UI_ICON_MICROPHONE,
-    COUNT_UI_ICONS,
-} UI_Icon;
+    bool running = p->analysis_thread != NULL;
+    analysis_stop();
+    fft_rings_lock();
+    Stems old = p->stems;
+    p->stems = fresh;
+    atomic_u64_store(&p->stems_cursor, 0);
+    fft_rings_unlock();
+    fft_clean();
+    stems_free(&old);
+    if (running) analysis_start();
+}
 
-static_assert(COUNT_UI_ICONS == 5, "Amount of icons changed");
-static const char *icon_file_paths[COUNT_UI_ICONS] = {
-    [UI_ICON_FULLSCREEN] = "./resources/icons/fullscreen.png",
-    [UI_ICON_VOLUME]     = "./resources/icons/volume.png",
-    [UI_ICON_PLAY]       = "./resources/icons/play.png",
-    [UI_ICON_RENDER]     = "./resources/icons/render.png",
-    [UI_ICON_MICROPHONE] = "./resources/icons/microphone.png",
-};
+// Waits for the loader and swaps its stems in if they are still the ones that are wanted
+static void stems_loader_join(const char *track_path, uint32_t sample_rate) {
+    Stems_Loader *l = &p->stems_loader;
+    if (l->thread == NULL) return;
+    thread_join(l->thread);
+    l->thread = NULL;
+    if (l->track_path == track_path && l->sample_rate == sample_rate) {
+        fft_swap_stems(l->stems);
+    } else {
+        stems_free(&l->stems);
+    }
+}
 
-typedef struct {
-    // Assets
-    Texture2D icon_textures[COUNT_UI_ICONS];
+// Loads the stems of the track at the sample rate unless they are loaded already. The preview
+// gets them in the background and keeps analyzing the track itself until they are decoded;
+// with wait the stems are there by the time this returns, like the rendering needs.
+static void fft_follow_stems(const char *track_path, uint32_t sample_rate, bool wait) {
+    Stems_Loader *l = &p->stems_loader;
+    if (l->thread != NULL) {
+        // A loader that is behind the track gets to finish anyway, LoadWave() can't be stopped
+        if (!wait && !atomic_u32_load(&l->done)) return;
+        stems_loader_join(track_path, sample_rate);
+    }
+    if (p->stems.track_path == track_path && p->stems.sample_rate == sample_rate) return;
+
+    Stems fresh;
+    if (track_path != NULL && !wait) {
+        l->track_path = track_path;
+        l->sample_rate = sample_rate;
+        atomic_u32_store(&l->done, 0);
+        l->thread = thread_start(stems_loader_thread, l);
+        if (l->thread != NULL) {
+            // The stems of the previous track are not what is playing anymore
+            memset(&fresh, 0, sizeof(fresh));
+            fft_swap_stems(fresh);
+            return;
+        }
+        TraceLog(LOG_WARNING, "ANALYSIS: falling back to loading the stems on the main thread");
+    }
+    stems_load(&fresh, track_path, sample_rate);
+    fft_swap_stems(fresh);
+}
 
-    // Visualizer
-    Tracks tracks;
-    int current_track;
-    Font font;
-    Shader circle;
-    int circle_radius_location;
-    int circle_power_location;
-    bool fullscreen;
+// Spectrogram Cache
+// Hash of the bytes of the audio file. Returns 0 if the file could not be read.
+static uint64_t file_content_hash(const char *file_path) {
+    uint64_t hash = 0;
+    Mapped_File *file = mapped_file_open(file_path);
+    if (file != NULL) {
+        hash = spectrogram_hash(mapped_file_data(file), mapped_file_size(file));
+        mapped_file_close(file);
+    }
+    return hash;
+}
 
-    // Renderer
-    bool rendering;
-    RenderTexture2D screen;
-    Wave wave;
-    float *wave_samples;
-    size_t wave_cursor;
-    FFMPEG *ffmpeg;
-    bool cancel_rendering;
+static void track_hasher_thread(void *arg) {
+    Track_Hasher *h = arg;
+    h->hash = file_content_hash(h->file_path);
+    atomic_u32_store(&h->done, 1);
+}
 
-    // FFT Analyzer
-    float in_raw[FFT_SIZE];
-    float in_win[FFT_SIZE];
-    Float_Complex out_raw[FFT_SIZE];
-    float out_log[FFT_SIZE];
-    float out_smooth[FFT_SIZE];
-    float out_smear[FFT_SIZE];
+// Waits for the hasher and hands the hash over to its track
+static void track_hasher_join(void) {
+    Track_Hasher *h = &p->hasher;
+    if (h->thread == NULL) return;
+    thread_join(h->thread);
+    h->thread = NULL;
+    for (size_t i = 0; i < p->tracks.count; ++i) {
+        Track *it = &p->tracks.items[i];
+        if (it->file_path == h->file_path) {
+            it->content_hash = h->hash;
+            it->content_hashed = true;
+        }
+    }
+}
 
-#ifndef MUSIALIZER_ACT_ON_PRESS
-    uint64_t active_button_id;
-#endif // MUSIALIZER_ACT_ON_PRESS
+// Hash of the bytes of the audio file of the track. Computed once per track. Mapping and hashing
+// a whole file takes a while, so the preview has the hasher do it and gets 0 until it's done,
+// just like for a file that could not be read. With wait the hash is there right away.
+static uint64_t track_content_hash(Track *track, bool wait) {
+    Track_Hasher *h = &p->hasher;
+    if (h->thread != NULL && (wait || atomic_u32_load(&h->done))) track_hasher_join();
+    if (track->content_hashed) return track->content_hash;
+    if (h->thread != NULL) return 0; // Still busy with another track, this one is next
+
+    if (!wait) {
+        h->file_path = track->file_path;
+        atomic_u32_store(&h->done, 0);
+        h->thread = thread_start(track_hasher_thread, h);
+        if (h->thread != NULL) return 0;
+        TraceLog(LOG_WARNING, "ANALYSIS: falling back to hashing %s on the main thread", track->file_path);
+    }
+    track->content_hash = file_content_hash(track->file_path);
+    track->content_hashed = true;
+    return track->content_hash;
+}
 
-    Popup_Tray pt;
+// The key of the bands of the track analyzed with the current settings. Returns false if the
+// track can't be cached, or not yet without wait, see track_content_hash().
+static bool fft_cache_key(Track *track, size_t fft_size, uint32_t sample_rate, bool wait, Spectrogram_Key *key) {
+    memset(key, 0, sizeof(*key));
+    // The key only knows about the audio of the track itself
+    if (p->stems.count > 0) return false;
+    key->content_hash = track_content_hash(track, wait);
+    key->sample_rate = sample_rate;
+    key->fft_size = fft_size;
+    key->fps = RENDER_FPS;
+    key->engine = atomic_u32_load(&p->analyzer_engine);
+    key->window = atomic_u32_load(&p->window_kind);
+    key->bands_scale = atomic_u32_load(&p->bands_scale);
+    key->bands_aggregate = atomic_u32_load(&p->bands_aggregate);
+    key->octave_divisions = ANALYSIS_OCTAVE_DIVISIONS;
+    key->ingest_mode = atomic_u32_load(&p->ingest_mode);
+    key->log_mode = atomic_u32_load(&p->log_mode);
+    return key->content_hash != 0;
+}
 
-    bool tooltip_show;
-    char tooltip_buffer[32];
-    Side tooltip_align;
-    Rectangle tooltip_element_boundary;
+static void fft_close_preview_cache(void) {
+    analysis_stop();
+    spectrogram_close(&p->preview_cache);
+    memset(&p->preview_cache_key, 0, sizeof(p->preview_cache_key));
+}
 
-#ifdef MUSIALIZER_MICROPHONE
-    // Microphone
-    bool capturing;
-    ma_device microphone;
-    drwav wav;
-    bool microphone_working;
-#endif // MUSIALIZER_MICROPHONE
-} Plug;
+// Called every frame of the preview with the track that is playing, or NULL if none is. Opens
+// the cache of the track whenever the track or the settings change, and tells the analysis
+// which frame of it the playback is at. Until the track is hashed the analysis is live.
+static void fft_follow_track(Track *track) {
+    fft_follow_stems(track != NULL ? track->file_path : NULL, atomic_u32_load(&p->sample_rate), false);
+    if (track != NULL && p->stems.count > 0) {
+        // The stems are fed along with the playback, see fft_push_stems(). A seek, a restart or
+        // a loop of the track makes it jump, so whenever the two disagree by a lot the stems
+        // jump after it.
+        uint32_t rate = p->stems.sample_rate;
+        int64_t played = GetMusicTimePlayed(track->music)*rate;
+        int64_t cursor = atomic_u64_load(&p->stems_cursor);
+        if (llabs(played - cursor) > STEMS_RESYNC_SECS*rate) {
+            fft_rings_lock();
+            atomic_u64_store(&p->stems_cursor, played);
+            fft_rings_unlock();
+        }
+    }
 
-static Plug *p = NULL;
+    Spectrogram_Key key = {0};
+    bool keyed = track != NULL && fft_cache_key(track, p->fft_size_preview, track->music.stream.sampleRate, false, &key);
+    if (memcmp(&key, &p->preview_cache_key, sizeof(key)) != 0) {
+        bool running = p->analysis_thread != NULL;
+        fft_close_preview_cache();
+        p->preview_cache_key = key;
+        if (keyed) {
+            char path[256];
+            spectrogram_path(path, sizeof(path), CACHE_DIR, &key);
+            if (spectrogram_open(&p->preview_cache, path, &key)) {
+                TraceLog(LOG_INFO, "ANALYSIS: preview from %s", path);
+            }
+        }
+        if (running) analysis_start();
+    }
 
-static bool fft_settled(void) {
-    float eps = 1e-3;
-    for (size_t i = 0; i < FFT_SIZE; ++i) {
-        if (p->out_smooth[i] > eps || p->out_smear[i] > eps) return false;
+    if (p->preview_cache.file != NULL) {
+        // raylib counts the time played from what the device has pulled, which is ahead of the
+        // speakers too
+        float played = GetMusicTimePlayed(track->music) - fft_playback_delay()/fft_analysis_rate();
+        uint32_t frame = played > 0.0f ? played*RENDER_FPS : 0;
+        if (frame != atomic_u32_load(&p->preview_frame)) {
+            atomic_u32_store(&p->preview_frame, frame);
+            // The playback may be paused, so nobody else is going to wake the analysis up
+            ma_event_signal(&p->analysis_wakeup);
+        }
     }
-    return true;
 }
 
-static void fft_clean(void) {
-    memset(p->in_raw, 0, sizeof(p->in_raw));
-    memset(p->in_win, 0, sizeof(p->in_win));
-    memset(p->out_raw, 0, sizeof(p->out_raw));
-    memset(p->out_log, 0, sizeof(p->out_log));
-    memset(p->out_smooth, 0, sizeof(p->out_smooth));
-    memset(p->out_smear, 0, sizeof(p->out_smear));
-}
-
-// FFT Implementation
-static void fft(float in[], size_t stride, Float_Complex out[], size_t n) {
-    assert(n > 0);
-    if (n == 1) {
-        out[0] = cfromreal(in[0]);
+// Offline Precompute
+// Pushes the audio frames [from, from + count) of the rendered track, or of its stems, into
+// the rings of the worker. The frames outside of the track are silence.
+static void precompute_push(Precompute_Worker *w, int64_t from, size_t count) {
+    Precompute *pc = &p->precompute;
+    if (p->stems.count > 0) {
+        fft_push_stems_into(&p->stems, w->rings, w->decimators, from, count);
         return;
     }
+    int64_t frame_count = p->wave.frameCount;
+    if (from < 0) {
+        size_t k = (uint64_t)-from < count ? (size_t)-from : count;
+        fft_push_silence_into(w->rings, w->decimators, pc->ingest_mode, k);
+        from += k;
+        count -= k;
+    }
+    if (count > 0 && from < frame_count) {
+        size_t k = (uint64_t)(frame_count - from) < count ? (size_t)(frame_count - from) : count;
+        fft_push_frames_into(w->rings, w->decimators, pc->ingest_mode, p->wave_samples + from*p->wave.channels, k, p->wave.channels);
+        from += k;
+        count -= k;
+    }
+    fft_push_silence_into(w->rings, w->decimators, pc->ingest_mode, count);
+}
 
-    fft(in, stride * 2, out, n / 2);
-    fft(in + stride, stride * 2, out + n / 2, n / 2);
-
-    for (size_t k = 0; k < n / 2; ++k) {
-        float t = (float)k / n;
-        Float_Complex v = mulcc(cexpf(cfromimag(-2  *PI * t)), out[k + n / 2]);
-        Float_Complex e = out[k];
-        out[k]          = addcc(e, v);
-        out[k + n / 2]  = subcc(e, v);
+// Analyzes one block of frames into the buffer. The analyzers start over from silence and
+// first take in the fft size worth of audio that precedes the block, which is everything the
+// engines could remember about it, plus the history of the decimation filter. Returns false
+// if it was interrupted.
+static bool precompute_block(Precompute_Worker *w, size_t block) {
+    Precompute *pc = &p->precompute;
+    size_t n = w->analyzers[0].size*pc->decimation + DECIMATOR_TAPS_MAX;
+    size_t begin = block*PRECOMPUTE_BLOCK_FRAMES;
+    size_t end = begin + PRECOMPUTE_BLOCK_FRAMES;
+    if (end > pc->frames) end = pc->frames;
+
+    for (size_t stream = 0; stream < pc->streams; ++stream) {
+        ring_clear(&w->rings[stream]);
+        decimator_reset(&w->decimators[stream]);
+        analyzer_clean(&w->analyzers[stream]);
+    }
+    precompute_push(w, (int64_t)(begin*pc->chunk) - (int64_t)n, n);
+    for (size_t frame = begin; frame < end; ++frame) {
+        if (atomic_u32_load(&pc->quit)) return false;
+        precompute_push(w, frame*pc->chunk, pc->chunk);
+        uint64_t heads[ANALYSIS_STREAMS_MAX] = {0};
+        for (size_t stream = 0; stream < pc->streams; ++stream) {
+            heads[stream] = atomic_u64_load(&w->rings[stream].head);
+        }
+        size_t m = fft_analyze_streams(w->analyzers, w->rings, &w->batch, pc->streams, heads);
+        if (m > pc->m) m = pc->m;
+        for (size_t stream = 0; stream < pc->streams; ++stream) {
+            Analyzer *a = &w->analyzers[stream];
+            float *out = pc->bands + (frame*pc->streams + stream)*pc->m;
+            memcpy(out, a->out_log, m*sizeof(*out));
+            memset(out + m, 0, (pc->m - m)*sizeof(*out));
+        }
     }
+    return true;
 }
 
-static inline float amp(Float_Complex z) {
-    float a = fabsf(crealf(z));
-    float b = fabsf(cimagf(z));
-    return logf(a * a + b * b);
+static void precompute_thread(void *arg) {
+    Precompute *pc = &p->precompute;
+    Precompute_Worker *w = arg;
+    for (;;) {
+        size_t block = w->index + atomic_u32_load(&w->blocks_done)*pc->workers_count;
+        if (block >= pc->blocks) break;
+        if (!precompute_block(w, block)) break;
+        atomic_u32_store(&w->blocks_done, atomic_u32_load(&w->blocks_done) + 1);
+    }
 }
 
-// FFT Analysis
-static size_t fft_analyze(float dt) {
-    for (size_t i = 0; i < FFT_SIZE; ++i) {
-        float t = (float)i / (FFT_SIZE - 1);
-        float hann = 0.5 - 0.5 * cosf(2 *PI * t);
-        p->in_win[i] = p->in_raw[i] * hann;
+// Stops the workers. Whatever they have finished stays in the buffer.
+static void precompute_pause(void) {
+    Precompute *pc = &p->precompute;
+    atomic_u32_store(&pc->quit, 1);
+    for (size_t i = 0; i < pc->workers_count; ++i) {
+        Precompute_Worker *w = &pc->workers[i];
+        if (w->thread == NULL) continue;
+        thread_join(w->thread);
+        w->thread = NULL;
     }
+}
 
-    fft(p->in_win, 1, p->out_raw, FFT_SIZE);
-    
-    // "Squash" into the Logarithmic Scale
-    float step = 1.06;
-    float lowf = 1.0f;
-    size_t m = 0;
-    float max_amp = 1.0f;
-    
-    for (float f = lowf; (size_t)f < FFT_SIZE / 2; f = ceilf(f * step)) {
-        float f1 = ceilf(f * step);
-        float a = 0.0f;
-        for (size_t q = (size_t)f; q < FFT_SIZE / 2 && q < (size_t)f1; ++q) {
-            float b = amp(p->out_raw[q]);
-            if (b > a) a = b;
+// (Re)starts the workers from the blocks they have not finished yet. The blocks of the
+// workers that could not be started are analyzed by precompute_analyze() on the main thread.
+static void precompute_resume(void) {
+    Precompute *pc = &p->precompute;
+    atomic_u32_store(&pc->quit, 0);
+    for (size_t i = 0; i < pc->workers_count; ++i) {
+        Precompute_Worker *w = &pc->workers[i];
+        if (w->thread != NULL) continue;
+        w->thread = thread_start(precompute_thread, w);
+        if (w->thread == NULL) {
+            TraceLog(LOG_WARNING, "ANALYSIS: could not start precompute worker %zu", i);
         }
-        if (max_amp < a) max_amp = a;
-        p->out_log[m++] = a;
     }
+}
 
-    // Normalize Frequencies to 0..1 range
-    for (size_t i = 0; i < m; ++i) {
-        p->out_log[i] /= max_amp;
+// Keeps the bands for the next time if the workers have finished all of them
+static void precompute_save(void) {
+    Precompute *pc = &p->precompute;
+    if (!pc->keyed || pc->bands == NULL) return;
+    size_t blocks_done = 0;
+    for (size_t i = 0; i < pc->workers_count; ++i) {
+        blocks_done += atomic_u32_load(&pc->workers[i].blocks_done);
     }
-
-    // Smooth and Smear Values
-    float smoothness = 8;
-    float smearness = 3;
-    for (size_t i = 0; i < m; ++i) {
-        p->out_smooth[i] += (p->out_log[i] - p->out_smooth[i]) * smoothness * dt;
-        p->out_smear[i] += (p->out_smooth[i] - p->out_smear[i]) * smearness * dt;
+    if (blocks_done < pc->blocks) return;
+
+    if (!nob_mkdir_if_not_exists(CACHE_DIR)) return;
+    char path[256];
+    spectrogram_path(path, sizeof(path), CACHE_DIR, &pc->key);
+    Spectrogram sg;
+    if (!spectrogram_create(&sg, path, &pc->key, pc->frames, pc->streams, pc->m)) return;
+    for (size_t frame = 0; frame < pc->frames; ++frame) {
+        for (size_t stream = 0; stream < pc->streams; ++stream) {
+            spectrogram_put(&sg, frame, stream, pc->bands + (frame*pc->streams + stream)*pc->m);
+        }
     }
-    return m;
+    spectrogram_close(&sg);
+    TraceLog(LOG_INFO, "ANALYSIS: cached the bands in %s", path);
 }
 
-// FFT Rendering
-static void fft_render(Rectangle boundary, size_t m) {
-    // The width of a single bar
-    float cell_width = boundary.width / m;
-
-    // Global color parameters
-    float saturation = 0.75f;
-    float value = 1.0f;
+// Also saves the bands into the cache if they are complete
+static void precompute_free(void) {
+    Precompute *pc = &p->precompute;
+    precompute_pause();
+    precompute_save();
+    spectrogram_close(&pc->cache);
+    for (size_t i = 0; i < pc->workers_count; ++i) {
+        Precompute_Worker *w = &pc->workers[i];
+        for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+            ring_free(&w->rings[stream]);
+            analyzer_free(&w->analyzers[stream]);
+        }
+        fft_batch_free(&w->batch);
+    }
+    free(pc->workers);
+    free(pc->bands);
+    memset(pc, 0, sizeof(*pc));
+}
 
-    // Render Bars
-    for (size_t i = 0; i < m; ++i) {
-        float hue = (float)i / m;
-        float t = p->out_smooth[i];
-        Color color = ColorFromHSV(hue * 360, saturation, value);
-        Vector2 startPos = {
-            boundary.x + i*cell_width + cell_width / 2,
-            boundary.y + boundary.height - boundary.height*2/3*t,
-        };
-        Vector2 endPos = {
-            boundary.x + i*cell_width + cell_width/2,
-            boundary.y + boundary.height,
-        };
-        float thick = cell_width / 3 * sqrtf(t);
-        DrawLineEx(startPos, endPos, thick, color);
+// Starts analyzing the track that start_rendering_track() has loaded on all of the
+// processors, unless its bands are in the cache already. Returns false if there is not enough
+// memory for that, in which case the rendering analyzes the frames one by one as they are
+// drawn.
+static bool precompute_start(Track *track) {
+    Precompute *pc = &p->precompute;
+    memset(pc, 0, sizeof(*pc));
+    size_t n = p->analyzers[0].size;
+    pc->chunk = p->wave.sampleRate/RENDER_FPS;
+    if (pc->chunk == 0) {
+        precompute_free();
+        return false;
+    }
+    pc->decimation = atomic_u32_load(&p->decimation);
+    // Until the analysis window is past the end of the track, in the frames of the track
+    size_t window = n*pc->decimation;
+    pc->frames = (p->wave.frameCount + window + pc->chunk - 1)/pc->chunk;
+    pc->ingest_mode = atomic_u32_load(&p->ingest_mode);
+    pc->streams = fft_streams();
+    pc->blocks = (pc->frames + PRECOMPUTE_BLOCK_FRAMES - 1)/PRECOMPUTE_BLOCK_FRAMES;
+
+    // The smoothing on the main thread needs the same band map as the workers
+    for (size_t stream = 0; stream < pc->streams; ++stream) {
+        fft_update_bands(&p->analyzers[stream]);
+    }
+    pc->m = p->analyzers[0].bands.count;
+    if (pc->m == 0) {
+        precompute_free();
+        return false;
     }
 
-    // Render Smears
-    Texture2D texture = { rlGetTextureIdDefault(), 1, 1, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
-    SetShaderValue(p->circle, p->circle_radius_location, (float[1]){0.3f}, SHADER_UNIFORM_FLOAT);
-    SetShaderValue(p->circle, p->circle_power_location, (float[1]){3.0f}, SHADER_UNIFORM_FLOAT);
-    BeginShaderMode(p->circle);
-    for (size_t i = 0; i < m; ++i) {
-        float start = p->out_smear[i];
-        float end = p->out_smooth[i];
-        float hue = (float)i / m;
-        Color color = ColorFromHSV(hue * 360, saturation, value);
-        Vector2 startPos = {
-            boundary.x + i*cell_width + cell_width/2,
-            boundary.y + boundary.height - boundary.height*2/3*start,
-        };
-        Vector2 endPos = {
-            boundary.x + i*cell_width + cell_width/2,
-            boundary.y + boundary.height - boundary.height*2/3*end,
-        };
-        float radius = cell_width * 3 * sqrtf(end);
-        Vector2 origin = {0};
-        
-        if (endPos.y >= startPos.y) {
-            Rectangle dest = {
-                .x = startPos.x - radius / 2,
-                .y = startPos.y,
-                .width = radius,
-                .height = endPos.y - startPos.y
-            };
-            Rectangle source = {0, 0, 1, 0.5};
-            DrawTexturePro(texture, source, dest, origin, 0, color);
-        } else {
-            Rectangle dest = {
-                .x = endPos.x - radius / 2,
-                .y = endPos.y,
-                .width = radius,
-                .height = startPos.y - endPos.y
-            };
-            Rectangle source = {0, 0.5, 1, 0.5};
-            DrawTexturePro(texture, source, dest, origin, 0, color);
+    pc->keyed = fft_cache_key(track, n, p->wave.sampleRate, true, &pc->key);
+    if (pc->keyed) {
+        char path[256];
+        spectrogram_path(path, sizeof(path), CACHE_DIR, &pc->key);
+        if (spectrogram_open(&pc->cache, path, &pc->key)) {
+            if (pc->cache.frames == pc->frames && pc->cache.streams == pc->streams && pc->cache.m == pc->m) {
+                TraceLog(LOG_INFO, "ANALYSIS: %zu frames from %s", pc->frames, path);
+                return true;
+            }
+            spectrogram_close(&pc->cache);
         }
     }
-    EndShaderMode();
 
-    // Render Circles
-    SetShaderValue(p->circle, p->circle_radius_location, (float[1]){0.07f}, SHADER_UNIFORM_FLOAT);
-    SetShaderValue(p->circle, p->circle_power_location, (float[1]){5.0f}, SHADER_UNIFORM_FLOAT);
-    BeginShaderMode(p->circle);
-    for (size_t i = 0; i < m; ++i) {
-        float t = p->out_smooth[i];
-        float hue = (float)i / m;
-        Color color = ColorFromHSV(hue * 360, saturation, value);
-        Vector2 center = {
-            boundary.x + i*cell_width + cell_width/2,
-            boundary.y + boundary.height - boundary.height*2/3*t,
-        };
-        float radius = cell_width * 6 * sqrtf(t);
-        Vector2 position = { .x = center.x - radius, .y = center.y - radius };
-        DrawTextureEx(texture, position, 0, 2*radius, color);
+    // NOTE: the window cache is not thread safe, so the tables the workers are going to ask
+    // for must already be there. The settings can't change while rendering.
+    Window_Kind window_kind = atomic_u32_load(&p->window_kind);
+    bool ok = window_cache_get(&p->windows, window_kind, n) != NULL &&
+              window_cache_get(&p->windows, window_kind, MULTIRES_LEVEL_SIZE_DEFAULT < n ? MULTIRES_LEVEL_SIZE_DEFAULT : n) != NULL;
+
+    size_t workers_count = thread_cpu_count();
+    if (workers_count > PRECOMPUTE_WORKERS_MAX) workers_count = PRECOMPUTE_WORKERS_MAX;
+    if (workers_count > pc->blocks) workers_count = pc->blocks;
+    pc->bands = malloc(pc->frames*pc->streams*pc->m*sizeof(*pc->bands));
+    pc->workers = calloc(workers_count, sizeof(*pc->workers));
+    ok = ok && pc->bands != NULL && pc->workers != NULL;
+    for (size_t i = 0; ok && i < workers_count; ++i) {
+        Precompute_Worker *w = &pc->workers[i];
+        w->index = i;
+        pc->workers_count += 1;
+        for (size_t stream = 0; ok && stream < pc->streams; ++stream) {
+            decimator_init(&w->decimators[stream], pc->decimation);
+            ok = ring_init(&w->rings[stream], 2*(n + pc->chunk)) &&
+                 analyzer_init(&w->analyzers[stream], n);
+        }
+        if (ok && pc->streams >= ANALYSIS_BATCH_MIN) ok = fft_batch_init(&w->batch, n, pc->streams);
     }
-    EndShaderMode();
+    if (!ok) {
+        TraceLog(LOG_WARNING, "ANALYSIS: could not allocate the precompute for %zu frames", pc->frames);
+        precompute_free();
+        return false;
+    }
+
+    precompute_resume();
+    TraceLog(LOG_INFO, "ANALYSIS: precomputing %zu frames on %zu workers", pc->frames, pc->workers_count);
+    return true;
 }
 
-// Push Frame Data
-static void fft_push(float frame) {
-    memmove(p->in_raw, p->in_raw + 1, (FFT_SIZE - 1) * sizeof(p->in_raw[0]));
-    p->in_raw[FFT_SIZE - 1] = frame;
+// Feeds the precomputed bands of the video frame into the smoothing of the analyzers. Returns
+// false if the workers are not there yet.
+static bool precompute_analyze(size_t frame, float dt) {
+    Precompute *pc = &p->precompute;
+    if (pc->cache.file == NULL && frame < pc->frames) {
+        size_t block = frame/PRECOMPUTE_BLOCK_FRAMES;
+        Precompute_Worker *w = &pc->workers[block%pc->workers_count];
+        size_t blocks_done = atomic_u32_load(&w->blocks_done);
+        if (block/pc->workers_count >= blocks_done) {
+            if (w->thread != NULL) return false;
+            // Nobody is going to do it for us
+            precompute_block(w, w->index + blocks_done*pc->workers_count);
+            atomic_u32_store(&w->blocks_done, blocks_done + 1);
+            return false;
+        }
+    }
+
+    for (size_t stream = 0; stream < pc->streams; ++stream) {
+        Analyzer *a = &p->analyzers[stream];
+        if (frame >= pc->frames) {
+            // Past the end the analysis window holds nothing but silence
+            memset(a->out_log, 0, pc->m*sizeof(*a->out_log));
+        } else if (pc->cache.file != NULL) {
+            spectrogram_get(&pc->cache, frame, stream, a->out_log, pc->m);
+        } else {
+            memcpy(a->out_log, pc->bands + (frame*pc->streams + stream)*pc->m, pc->m*sizeof(*a->out_log));
+        }
+        fft_smooth_bands(a, pc->m, dt);
+    }
+    return true;
 }
 
 // Audio Callback
-static void callback(void *bufferData, unsigned int frames) {
-    // https://cdecl.org/?q=float+%28*fs%29%5B2%5D
-    float(*fs)[2] = bufferData; // Treating music as 2 channels
-    for (size_t i = 0; i < frames; ++i) {
-        fft_push(fs[i][0]);
-    }
+static void feed(void *bufferData, unsigned int frames) {
+    fft_push_frames(bufferData, frames, PLAYBACK_CHANNELS);
+    ma_event_signal(&p->analysis_wakeup);
 
 #ifdef MUSIALIZER_MICROPHONE
     if (p->capturing) {
@@ -416,14 +2362,236 @@ static void callback(void *bufferData, unsigned int frames) {
 #endif // MUSIALIZER_MICROPHONE
 }
 
+// The device pulls a whole period at a time and raylib hands it over to us right away,
+// possibly in a few pieces. The pieces that arrive together add up to the period.
+static void callback(void *bufferData, unsigned int frames) {
+    double now = GetTime();
+    if (now - p->playback_burst_time > PLAYBACK_BURST_SECS) {
+        if (p->playback_burst_frames > 0) {
+            atomic_u32_store(&p->playback_latency, p->playback_burst_frames*PLAYBACK_PERIODS);
+        }
+        p->playback_burst_frames = 0;
+    }
+    p->playback_burst_time = now;
+    p->playback_burst_frames += frames;
+    atomic_u64_store(&p->playback_nanos, now*1e9);
+    feed(bufferData, frames);
+}
+
 #ifdef MUSIALIZER_MICROPHONE
 static void ma_callback(ma_device *pDevice, void *pOutput, const void *pInput, ma_uint32 frameCount) {
-    callback((void*)pInput, frameCount);
+    // The microphone hears things before we do, there is nothing to wait for
+    atomic_u32_store(&p->playback_latency, 0);
+    feed((void*)pInput, frameCount);
     (void)pOutput;
     (void)pDevice;
 }
 #endif // MUSIALIZER_MICROPHONE
 
+// Seek Prefill
+// Right after a seek the rings are still full of the audio from before it, and the audio after
+// it only trickles in as it's played. So the seek decodes the analysis window that precedes
+// the new position itself, with the same decoders raylib plays the file with, and pushes it
+// into the rings right away.
+
+// Amount of frames of the `duration` seconds that precede `position`, at the sample rate.
+// The ones before the start of the file don't count. `*from` gets the first one.
+static size_t prefill_range(double position, double duration, uint32_t sample_rate, uint64_t *from) {
+    uint64_t end = position*sample_rate;
+    uint64_t count = ceil(duration*sample_rate);
+    if (count > end) count = end;
+    *from = end - count;
+    return count;
+}
+
+// Decodes the `duration` seconds of the file of the track that precede `position` as
+// interleaved floats in the format of the file, which goes into `channels` and `sample_rate`.
+// The buffer is allocated with malloc(). Returns NULL if the format is not supported or
+// decoding failed.
+static float *prefill_decode(Track *track, double position, double duration, size_t *frames, uint32_t *channels, uint32_t *sample_rate) {
+    const char *file_path = track->file_path;
+    float *out = NULL;
+    *frames = 0;
+    uint64_t from;
+    if (IsFileExtension(file_path, ".wav")) {
+        drwav wav;
+        if (!drwav_init_file(&wav, file_path, NULL)) return NULL;
+        *channels = wav.channels;
+        *sample_rate = wav.sampleRate;
+        size_t count = prefill_range(position, duration, wav.sampleRate, &from);
+        out = malloc((count + 1)*wav.channels*sizeof(*out));
+        if (out != NULL && drwav_seek_to_pcm_frame(&wav, from)) {
+            *frames = drwav_read_pcm_frames_f32(&wav, count, out);
+        }
+        drwav_uninit(&wav);
+    } else if (IsFileExtension(file_path, ".mp3")) {
+        drmp3 mp3;
+        if (!drmp3_init_file(&mp3, file_path, NULL)) return NULL;
+        // Without a seek table dr_mp3 seeks by decoding everything from the start. Finding the
+        // seek points only takes the headers of the MP3 frames, and it's done once per track.
+        if (track->mp3_seek_points == NULL) {
+            drmp3_uint32 count = PREFILL_MP3_SEEK_POINTS;
+            drmp3_seek_point *points = malloc(count*sizeof(*points));
+            if (points != NULL && drmp3_calculate_seek_points(&mp3, &count, points)) {
+                track->mp3_seek_points = points;
+                track->mp3_seek_points_count = count;
+            } else {
+                free(points);
+            }
+        }
+        if (track->mp3_seek_points != NULL) {
+            drmp3_bind_seek_table(&mp3, track->mp3_seek_points_count, track->mp3_seek_points);
+        }
+        *channels = mp3.channels;
+        *sample_rate = mp3.sampleRate;
+        size_t count = prefill_range(position, duration, mp3.sampleRate, &from);
+        out = malloc((count + 1)*mp3.channels*sizeof(*out));
+        if (out != NULL && drmp3_seek_to_pcm_frame(&mp3, from)) {
+            *frames = drmp3_read_pcm_frames_f32(&mp3, count, out);
+        }
+        drmp3_uninit(&mp3);
+    } else if (IsFileExtension(file_path, ".ogg")) {
+        stb_vorbis *vorbis = stb_vorbis_open_filename(file_path, NULL, NULL);
+        if (vorbis == NULL) return NULL;
+        stb_vorbis_info info = stb_vorbis_get_info(vorbis);
+        *channels = info.channels;
+        *sample_rate = info.sample_rate;
+        size_t count = prefill_range(position, duration, info.sample_rate, &from);
+        out = malloc((count + 1)*info.channels*sizeof(*out));
+        if (out != NULL && (from == 0 || stb_vorbis_seek(vorbis, from))) {
+            *frames = stb_vorbis_get_samples_float_interleaved(vorbis, info.channels, out, count*info.channels);
+        }
+        stb_vorbis_close(vorbis);
+    } else if (IsFileExtension(file_path, ".flac")) {
+        drflac *flac = drflac_open_file(file_path, NULL);
+        if (flac == NULL) return NULL;
+        *channels = flac->channels;
+        *sample_rate = flac->sampleRate;
+        size_t count = prefill_range(position, duration, flac->sampleRate, &from);
+        out = malloc((count + 1)*flac->channels*sizeof(*out));
+        if (out != NULL && drflac_seek_to_pcm_frame(flac, from)) {
+            *frames = drflac_read_pcm_frames_f32(flac, count, out);
+        }
+        drflac_close(flac);
+    } else if (IsFileExtension(file_path, ".qoa")) {
+        FILE *file = fopen(file_path, "rb");
+        if (file == NULL) return NULL;
+        unsigned char header[QOA_MIN_FILESIZE];
+        qoa_desc qoa = {0};
+        unsigned int first_frame = 0;
+        if (fread(header, 1, sizeof(header), file) == sizeof(header)) {
+            first_frame = qoa_decode_header(header, sizeof(header), &qoa);
+        }
+        if (first_frame == 0) {
+            fclose(file);
+            return NULL;
+        }
+        *channels = qoa.channels;
+        *sample_rate = qoa.samplerate;
+        size_t count = prefill_range(position, duration, qoa.samplerate, &from);
+        out = malloc((count + 1)*qoa.channels*sizeof(*out));
+        // All of the frames but the last one are of the same size and carry the state of the
+        // decoder in their headers, so the seeking is just like in qoaplay_seek_frame()
+        unsigned int frame_size = qoa_max_frame_size(&qoa);
+        unsigned char *bytes = malloc(frame_size);
+        short *samples = malloc(QOA_FRAME_LEN*qoa.channels*sizeof(*samples));
+        size_t skip = from%QOA_FRAME_LEN;
+        long offset = first_frame + from/QOA_FRAME_LEN*frame_size;
+        if (out != NULL && bytes != NULL && samples != NULL && fseek(file, offset, SEEK_SET) == 0) {
+            while (*frames < count) {
+                unsigned int size = fread(bytes, 1, frame_size, file);
+                unsigned int len = 0;
+                if (qoa_decode_frame(bytes, size, &qoa, samples, &len) == 0 || len <= skip) break;
+                size_t n = len - skip;
+                if (n > count - *frames) n = count - *frames;
+                for (size_t i = 0; i < n*qoa.channels; ++i) {
+                    out[*frames*qoa.channels + i] = samples[skip*qoa.channels + i]/32768.0f;
+                }
+                *frames += n;
+                skip = 0;
+            }
+        }
+        free(samples);
+        free(bytes);
+        fclose(file);
+    }
+    return out;
+}
+
+// Moves the bars right to the latest analysis. Normally they take a moment to catch up with it.
+static void fft_snap(void) {
+    for (size_t stream = 0; stream < fft_streams(); ++stream) {
+        Analyzer *a = &p->analyzers[stream];
+        size_t m = a->bands.count;
+        memcpy(a->out_smooth, a->out_log, m*sizeof(*a->out_smooth));
+        memcpy(a->out_smear, a->out_log, m*sizeof(*a->out_smear));
+        fft_smooth_bands(a, m, 0.0f);
+    }
+}
+
+// Called right after the track was seeked to `position` seconds
+static void fft_prefill(Track *track, float position) {
+    bool running = p->analysis_thread != NULL;
+    analysis_stop();
+    fft_follow_track(track);
+
+    if (p->preview_cache.file == NULL) {
+        // The whole analysis window, including the part of it that is still on the way to the
+        // speakers and the history of the decimation filter, in the frames of the device
+        uint32_t rate = atomic_u32_load(&p->sample_rate);
+        size_t want = (p->analyzers[0].size + fft_playback_delay())*atomic_u32_load(&p->decimation) + DECIMATOR_TAPS_MAX;
+        if (p->stems.count > 0) {
+            // The stems are in memory already, at the sample rate of the device
+            int64_t end = (double)position*rate;
+            fft_rings_begin_push();
+            for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) decimator_reset(&p->decimators[stream]);
+            fft_push_stems_into(&p->stems, p->rings, p->decimators, end - (int64_t)want, want);
+            atomic_u64_store(&p->stems_cursor, end);
+            fft_rings_unlock();
+        } else {
+            size_t frames = 0;
+            uint32_t channels = 0, sample_rate = 0;
+            float *decoded = prefill_decode(track, position, (double)want/rate, &frames, &channels, &sample_rate);
+            float *converted = NULL;
+            size_t count = 0;
+            if (frames > 0) {
+                // The rings get the audio in the format of the device, see PLAYBACK_CHANNELS
+                size_t capacity = want + 1;
+                converted = malloc(capacity*PLAYBACK_CHANNELS*sizeof(*converted));
+                if (converted != NULL) {
+                    count = ma_convert_frames(converted, capacity, ma_format_f32, PLAYBACK_CHANNELS, rate,
+                                              decoded, frames, ma_format_f32, channels, sample_rate);
+                    if (count > want) count = want;
+                }
+            }
+
+            if (decoded != NULL || position <= 0.0f) {
+                Ingest_Mode mode = atomic_u32_load(&p->ingest_mode);
+                fft_rings_begin_push();
+                // The filter must not remember the audio from before the seek
+                for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) decimator_reset(&p->decimators[stream]);
+                // Silence for the part of the window before the start of the track
+                fft_push_silence_into(p->rings, p->decimators, mode, want - count);
+                fft_push_frames_into(p->rings, p->decimators, mode, converted, count, PLAYBACK_CHANNELS);
+                fft_rings_unlock();
+            } else {
+                TraceLog(LOG_WARNING, "ANALYSIS: could not prefill the analysis of %s after seeking", track->file_path);
+            }
+            free(decoded);
+            free(converted);
+        }
+    }
+
+    // Whatever the stateful engines have seen belongs to the old position
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        p->analyzers[stream].multires_primed = false;
+        sdft_reset(&p->analyzers[stream].sdft);
+    }
+    fft_analyze_preview(0.0f);
+    fft_snap();
+    if (running) analysis_start();
+}
+
 static Track *current_track(void) {
     if (0 <= p->current_track && (size_t) p->current_track < p->tracks.count) {
         return &p->tracks.items[p->current_track];
@@ -576,6 +2744,7 @@ static void timeline(Rectangle timeline_boundary, Track *track) {
         if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
             float t = (mouse.x - timeline_boundary.x) / timeline_boundary.width;
             SeekMusicStream(track->music, t*len);
+            fft_prefill(track, t*len);
         }
     }
     // TODO: enable the user to render a specific region instead of the whole song.
@@ -681,6 +2850,7 @@ static void tracks_panel_with_location(const char *file, int line, Rectangle pan
         panel_velocity += GetMouseWheelMove()*item_size*8;
     }
     panel_scroll -= panel_velocity*GetFrameTime();
+    if (fabsf(panel_velocity) > 1.0f) p->animating = true;
 
     static bool scrolling = false;
     static float scrolling_mouse_offset = 0.0f;
@@ -1022,6 +3192,7 @@ static void popup_tray(Popup_Tray *pt, Rectangle preview_boundary) {
     while (pt->count > 0 && PT_LAST(pt)->lifetime <= 0) {
         pt->count -= 1;
     }
+    if (pt->count > 0) p->animating = true;
 }
 
 #define cancel_rendering_button(boundary) \
@@ -1164,11 +3335,20 @@ static void toggle_track_playing(Track *track) {
 static void start_rendering_track(Track *track) {
     StopMusicStream(track->music);
 
-    fft_clean();
+    // The preview opens the cache again afterwards, possibly the one this rendering is about
+    // to make
+    fft_close_preview_cache();
+    fft_resize(fft_size_for_render());
     // TODO: LoadWave is pretty slow on big files
     p->wave = LoadWave(track->file_path);
     p->wave_cursor = 0;
     p->wave_samples = LoadWaveSamples(p->wave);
+    p->sample_rate_preview = p->sample_rate;
+    fft_set_sample_rate(p->wave.sampleRate);
+    // The video goes through the stems from the start, along with wave_cursor
+    fft_follow_stems(track->file_path, p->wave.sampleRate, true);
+    atomic_u64_store(&p->stems_cursor, 0);
+    precompute_start(track);
     // TODO: set the rendering output path based on the input path
     // Basically output into the same folder
     p->ffmpeg = ffmpeg_start_rendering(p->screen.texture.width, p->screen.texture.height, RENDER_FPS, track->file_path);
@@ -1344,6 +3524,7 @@ static void preview_screen(void) {
 #endif // MUSIALIZER_MICROPHONE
 
     Track *track = current_track();
+    fft_follow_track(track);
     if (track) { // The music is loaded and ready
         UpdateMusicStream(track->music);
 
@@ -1354,6 +3535,7 @@ static void preview_screen(void) {
         if (IsKeyPressed(KEY_RESTART_PLAY)) {
             StopMusicStream(track->music);
             PlayMusicStream(track->music);
+            fft_prefill(track, 0.0f);
         }
 
         if (IsKeyPressed(KEY_RENDER)) {
@@ -1364,8 +3546,49 @@ static void preview_screen(void) {
             p->fullscreen = !p->fullscreen;
         }
 
-        size_t m = fft_analyze(GetFrameTime());
-        
+        if (IsKeyPressed(KEY_FFT_SIZE_DOWN)) fft_change_size_preview(p->fft_size_preview/2);
+        if (IsKeyPressed(KEY_FFT_SIZE_UP))   fft_change_size_preview(p->fft_size_preview*2);
+        if (IsKeyPressed(KEY_FFT_HOP_DOWN))  fft_change_hop(p->fft_hop/2);
+        if (IsKeyPressed(KEY_FFT_HOP_UP))    fft_change_hop(p->fft_hop*2);
+        if (IsKeyPressed(KEY_ANALYZER_ENGINE)) {
+            fft_change_engine((p->analyzer_engine + 1)%COUNT_ANALYZER_ENGINES);
+        }
+        if (IsKeyPressed(KEY_BANDS_SCALE)) {
+            fft_change_bands_scale((p->bands_scale + 1)%COUNT_BANDS_SCALES);
+        }
+        if (IsKeyPressed(KEY_BANDS_AGGREGATE)) {
+            fft_change_bands_aggregate((p->bands_aggregate + 1)%COUNT_BANDS_AGGREGATES);
+        }
+        if (IsKeyPressed(KEY_WINDOW)) {
+            fft_change_window((p->window_kind + 1)%COUNT_WINDOWS);
+        }
+        if (IsKeyPressed(KEY_LOG_MODE)) {
+            fft_change_log_mode((p->log_mode + 1)%COUNT_FFT_LOG_MODES);
+        }
+        if (IsKeyPressed(KEY_INGEST_MODE)) {
+            fft_change_ingest_mode((p->ingest_mode + 1)%COUNT_INGEST_MODES);
+        }
+        if (IsKeyPressed(KEY_LATENCY_DOWN)) {
+            fft_change_latency_offset((int32_t)p->latency_offset - LATENCY_OFFSET_STEP_MS);
+        }
+        if (IsKeyPressed(KEY_LATENCY_UP)) {
+            fft_change_latency_offset((int32_t)p->latency_offset + LATENCY_OFFSET_STEP_MS);
+        }
+        if (IsKeyPressed(KEY_LAYOUT)) {
+            fft_change_layout((p->layout + 1)%COUNT_LAYOUTS);
+        }
+        if (IsKeyPressed(KEY_RENDER_BACKEND)) {
+            fft_change_render_backend((p->render_backend + 1)%COUNT_RENDER_BACKENDS);
+        }
+        if (IsKeyPressed(KEY_PALETTE)) {
+            fft_change_palette((p->palette + 1)%p->palettes_count);
+        }
+        if (IsKeyPressed(KEY_BLOOM)) {
+            fft_change_bloom(!p->bloom);
+        }
+
+        if (p->analysis_thread == NULL) fft_analyze_preview(GetFrameTime());
+
         float toolbar_height = HUD_BUTTON_SIZE;
         if (p->fullscreen) {
             static float hud_timer = HUD_TIMER_SECS;
@@ -1379,6 +3602,7 @@ static void preview_screen(void) {
 
             if (hud_timer > 0.0) {
                 hud_timer -= GetFrameTime();
+                p->animating = true;
 
                 preview_boundary.height -= toolbar_height;
                 bool interacted = toolbar(track, CLITERAL(Rectangle) {
@@ -1395,7 +3619,7 @@ static void preview_screen(void) {
             bool moved = fabsf(delta.x) + fabsf(delta.y) > 0.0;
             if (moved) hud_timer = HUD_TIMER_SECS;
 
-            fft_render(preview_boundary, m);
+            fft_render(preview_boundary);
 #if 0
             // TODO: toggle track playing on right mouse click on the preview
             if (button(preview_boundary) & BS_CLICKED) {
@@ -1423,10 +3647,10 @@ static void preview_screen(void) {
             (void) button_with_location;
 #endif
 
-            BeginScissorMode(preview_boundary.x, preview_boundary.y, preview_boundary.width, preview_boundary.height);
-            fft_render(preview_boundary, m);
+            begin_clip(preview_boundary);
+            fft_render(preview_boundary);
             popup_tray(&p->pt, preview_boundary);
-            EndScissorMode();
+            end_clip();
 
             tracks_panel((CLITERAL(Rectangle) {
                 .x = 0,
@@ -1469,6 +3693,9 @@ static void capture_screen(void) {
     int w = GetScreenWidth();
     int h = GetScreenHeight();
 
+    // The microphone is analyzed live
+    fft_follow_track(NULL);
+
     if (p->microphone_working) {
         if (IsKeyPressed(KEY_CAPTURE_MICROPHONE) || IsKeyPressed(KEY_ESCAPE)) {
             ma_device_uninit(&p->microphone);
@@ -1496,10 +3723,10 @@ static void capture_screen(void) {
             }
         }
 
-        size_t m = fft_analyze(GetFrameTime());
+        if (p->analysis_thread == NULL) fft_analyze(0, GetFrameTime());
         fft_render(CLITERAL(Rectangle) {
             0, 0, GetScreenWidth(), GetScreenHeight()
-        }, m);
+        });
     } else {
         if (IsKeyPressed(KEY_ESCAPE)) {
             p->capturing = false;
@@ -1534,10 +3761,12 @@ static void rendering_screen(void) {
     if (p->ffmpeg == NULL) { // Starting FFmpeg process has failed for some reason
         if (IsKeyPressed(KEY_ESCAPE)) {
             SetTraceLogLevel(LOG_INFO);
+            precompute_free();
             UnloadWave(p->wave);
             UnloadWaveSamples(p->wave_samples);
             p->rendering = false;
-            fft_clean();
+            fft_restore_preview();
+            analysis_start();
             PlayMusicStream(track->music);
         }
 
@@ -1568,10 +3797,12 @@ static void rendering_screen(void) {
                 p->ffmpeg = NULL;
             } else {
                 SetTraceLogLevel(LOG_INFO);
+                precompute_free();
                 UnloadWave(p->wave);
                 UnloadWaveSamples(p->wave_samples);
                 p->rendering = false;
-                fft_clean();
+                fft_restore_preview();
+                analysis_start();
                 PlayMusicStream(track->music);
             }
         } else if (IsKeyPressed(KEY_ESCAPE) || p->cancel_rendering) { // Rendering is cancelled
@@ -1579,10 +3810,12 @@ static void rendering_screen(void) {
             p->ffmpeg = NULL;
 
             SetTraceLogLevel(LOG_INFO);
+            precompute_free();
             UnloadWave(p->wave);
             UnloadWaveSamples(p->wave_samples);
             p->rendering = false;
-            fft_clean();
+            fft_restore_preview();
+            analysis_start();
             PlayMusicStream(track->music);
         } else { // Rendering is going...
             const char *label = "Rendering video...";
@@ -1628,34 +3861,53 @@ static void rendering_screen(void) {
             }
 
             // Rendering
-            {
-                size_t chunk_size = p->wave.sampleRate / RENDER_FPS;
-                float *fs = (float*)p->wave_samples;
-                for (size_t i = 0; i < chunk_size; ++i) {
-                    if (p->wave_cursor < p->wave.frameCount) {
-                        fft_push(fs[p->wave_cursor*p->wave.channels + 0]);
-                    } else {
-                        fft_push(0);
-                    }
-                    p->wave_cursor += 1;
+            size_t chunk_size = p->wave.sampleRate / RENDER_FPS;
+            if (p->precompute.frames > 0) {
+                // The workers may not have gotten to this frame yet. Then we just show the
+                // progress and try again on the next one.
+                if (!precompute_analyze(p->wave_cursor/chunk_size, 1.0f / RENDER_FPS)) return;
+            } else {
+                size_t available = 0;
+                if (p->wave_cursor < p->wave.frameCount) {
+                    available = p->wave.frameCount - p->wave_cursor;
+                    if (available > chunk_size) available = chunk_size;
+                    float *fs = p->wave_samples + p->wave_cursor*p->wave.channels;
+                    fft_push_frames(fs, available, p->wave.channels);
                 }
-            }
+                // Past the end of the track we keep feeding silence so the spectrum can settle
+                fft_push_silence(chunk_size - available);
 
-            size_t m = fft_analyze(1.0f / RENDER_FPS);
-
-            BeginTextureMode(p->screen);
-            ClearBackground(COLOR_BACKGROUND);
-            fft_render(CLITERAL(Rectangle) {
-                0, 0, p->screen.texture.width, p->screen.texture.height
-            }, m);
-            EndTextureMode();
+                // NOTE: the analysis thread is stopped while rendering, so every video frame gets
+                // exactly one analysis step of 1/RENDER_FPS and the output is deterministic
+                fft_analyze(0, 1.0f / RENDER_FPS);
+            }
+            p->wave_cursor += chunk_size;
+
+            if (p->render_backend == RENDER_BACKEND_SOFTWARE) {
+                // Straight from the rasterizer into ffmpeg, the GPU is not involved at all. There
+                // is no bloom without it, so the circles keep their full size.
+                size_t width = p->screen.texture.width;
+                size_t height = p->screen.texture.height;
+                fft_rasterize(width, height, CLITERAL(Rectangle) {0, 0, width, height}, COLOR_BACKGROUND, 1.0f);
+                if (!ffmpeg_send_frame(p->ffmpeg, p->raster.image.pixels, width, height)) {
+                    ffmpeg_end_rendering(p->ffmpeg, false);
+                    p->ffmpeg = NULL;
+                }
+            } else {
+                begin_target(&p->screen);
+                ClearBackground(COLOR_BACKGROUND);
+                fft_render(CLITERAL(Rectangle) {
+                    0, 0, p->screen.texture.width, p->screen.texture.height
+                });
+                end_target();
 
-            Image image = LoadImageFromTexture(p->screen.texture);
-            if (!ffmpeg_send_frame_flipped(p->ffmpeg, image.data, image.width, image.height)) {
-                ffmpeg_end_rendering(p->ffmpeg, false);
-                p->ffmpeg = NULL;
+                Image image = LoadImageFromTexture(p->screen.texture);
+                if (!ffmpeg_send_frame_flipped(p->ffmpeg, image.data, image.width, image.height)) {
+                    ffmpeg_end_rendering(p->ffmpeg, false);
+                    p->ffmpeg = NULL;
+                }
+                UnloadImage(image);
             }
-            UnloadImage(image);
         }
     }
 }
@@ -1677,8 +3929,30 @@ static void load_assets(void) {
         p->circle = LoadShaderFromMemory(NULL, data);
         p->circle_radius_location = GetShaderLocation(p->circle, "radius");
         p->circle_power_location = GetShaderLocation(p->circle, "power");
+        const char *bars_path = "./resources/shaders/bars.vs";
+        void *bars_data = plug_load_resource(bars_path, &data_size);
+            p->bars_flat = bars_shader_load(bars_data, NULL);
+            p->bars_circle = bars_shader_load(bars_data, data);
+        plug_free_resource(bars_data);
+    plug_free_resource(data);
+    bars_load();
+
+    const char *spectrum_path = "./resources/shaders/spectrum.fs";
+    data = plug_load_resource(spectrum_path, &data_size);
+        p->spectrum = spectrum_shader_load(data);
+    plug_free_resource(data);
+
+    const char *bloom_down_path = "./resources/shaders/bloom_down.fs";
+    data = plug_load_resource(bloom_down_path, &data_size);
+        p->bloom_down = bloom_shader_load(data);
     plug_free_resource(data);
 
+    const char *bloom_up_path = "./resources/shaders/bloom_up.fs";
+    data = plug_load_resource(bloom_up_path, &data_size);
+        p->bloom_up = bloom_shader_load(data);
+    plug_free_resource(data);
+    fft_update_palette_texture();
+
     for (UI_Icon icon=0; icon<COUNT_UI_ICONS; ++icon) {
         data = plug_load_resource(icon_file_paths[icon], &data_size);
             Image image = LoadImageFromMemory(GetFileExtension(icon_file_paths[icon]), data, data_size);
@@ -1693,6 +3967,19 @@ static void load_assets(void) {
 static void unload_assets() {
     UnloadFont(p->font);
     UnloadShader(p->circle);
+    UnloadShader(p->bars_flat.shader);
+    UnloadShader(p->bars_circle.shader);
+    bars_unload();
+    UnloadShader(p->spectrum.shader);
+    if (p->spectrum_texture.id != 0) UnloadTexture(p->spectrum_texture);
+    p->spectrum_texture = CLITERAL(Texture2D) {0};
+    UnloadTexture(p->palette_texture);
+    p->palette_texture = CLITERAL(Texture2D) {0};
+    UnloadShader(p->bloom_down.shader);
+    UnloadShader(p->bloom_up.shader);
+    bloom_unload();
+    if (p->raster.texture.id != 0) UnloadTexture(p->raster.texture);
+    p->raster.texture = CLITERAL(Texture2D) {0};
     for (UI_Icon icon = 0; icon < COUNT_UI_ICONS; ++icon) {
         UnloadTexture(p->icon_textures[icon]);
     }
@@ -1703,15 +3990,49 @@ MUSIALIZER_PLUG void plug_init(void) {
     assert(p != NULL && "Buy more RAM lol");
     memset(p, 0, sizeof(*p));
 
+    // Twice the biggest analysis window, so the audio thread can run ahead of fft_analyze()
+    // without tearing its snapshot, plus the samples that are still on their way to the
+    // speakers. The rings are shared with the audio callback, so unlike the rest of the
+    // analyzers they are never reallocated when the FFT size changes.
+    bool ok = true;
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        ok = ok && ring_init(&p->rings[stream], 2*FFT_SIZE_MAX + LATENCY_MAX_FRAMES);
+    }
+    assert(ok && "Buy more RAM lol");
+    p->fft_size_preview = FFT_SIZE_DEFAULT;
+    p->fft_size_render = RENDER_FFT_SIZE;
+    p->fft_hop = FFT_HOP_DEFAULT;
+    // The bars are normalized and smoothed anyway, nobody can see the difference
+    p->log_mode = FFT_LOG_FAST;
+    fft_set_sample_rate(ANALYSIS_SAMPLE_RATE_DEFAULT);
+    for (size_t stream = 0; stream < ANALYSIS_STREAMS_MAX; ++stream) {
+        ok = ok && analyzer_init(&p->analyzers[stream], p->fft_size_preview);
+    }
+    ok = ok && fft_batch_init(&p->batch, p->fft_size_preview, ANALYSIS_STREAMS_MAX);
+    assert(ok && "Buy more RAM lol");
+    (void) ok;
+    fft_select_kernels();
+    if (ma_event_init(&p->analysis_wakeup) != MA_SUCCESS) {
+        assert(0 && "Could not create an event for the analysis thread");
+    }
+
+    palettes_load();
     load_assets();
     p->screen = LoadRenderTexture(RENDER_WIDTH, RENDER_HEIGHT);
     p->current_track = -1;
 
     SetMasterVolume(0.5);
+    analysis_start();
 }
 
 // Pre-reload Function
 MUSIALIZER_PLUG void *plug_pre_reload(void) {
+    // The code of the analysis thread and of the other workers is about to be unloaded
+    analysis_stop();
+    precompute_pause();
+    raster_stop();
+    stems_loader_join(p->stems_loader.track_path, p->stems_loader.sample_rate);
+    track_hasher_join();
     for (size_t i = 0; i < p->tracks.count; ++i) {
         Track *it = &p->tracks.items[i];
         DetachAudioStreamProcessor(it->music.stream, callback);
@@ -1727,10 +4048,50 @@ MUSIALIZER_PLUG void plug_post_reload(void *prev) {
         Track *it = &p->tracks.items[i];
         AttachAudioStreamProcessor(it->music.stream, callback);
     }
+    // The kernel selection lives in the static memory of the plug, so it's gone after the reload
+    fft_select_kernels();
     load_assets();
+    if (!p->rendering) analysis_start();
+    if (p->precompute.bands != NULL) precompute_resume();
+}
+
+// Whether the frame on the screen stays the same until there is some input
+static bool idle_check(void) {
+    if (p->rendering || p->animating) return false;
+#ifdef MUSIALIZER_MICROPHONE
+    if (p->capturing) return false;
+#endif // MUSIALIZER_MICROPHONE
+    Track *track = current_track();
+    if (track != NULL && IsMusicStreamPlaying(track->music)) return false;
+    // Without the analysis thread the bars only stay put once they are down
+    if (p->analysis_thread == NULL) return fft_settled();
+    // It goes to sleep after publishing the last spectrum. If that came after the spectra were
+    // drawn, the next frame still has to show it.
+    if (!atomic_u32_load(&p->analysis_asleep)) return false;
+    for (size_t stream = 0; stream < fft_streams(); ++stream) {
+        if (triple_buffer_fresh(&p->analyzers[stream].spectra_tb)) return false;
+    }
+    return true;
+}
+
+// Nothing is playing, the bars have stopped moving and nothing else is animating, so drawing
+// the same frame over and over just keeps a processor and the GPU busy, especially with
+// FLAG_WINDOW_ALWAYS_RUN. Then EndDrawing() waits for the next event instead, which wakes it up
+// right away on any input, including the input that starts the playback. A minimized or
+// hidden window keeps going while the music plays, because something has to keep feeding the
+// music streams, but fft_render() skips the spectra.
+static void idle_update(void) {
+    bool waiting = idle_check();
+    if (waiting != p->event_waiting) {
+        if (waiting) EnableEventWaiting();
+        else DisableEventWaiting();
+        p->event_waiting = waiting;
+    }
+    p->animating = false;
 }
 
 MUSIALIZER_PLUG void plug_update(void) {
+    p->hidden = IsWindowMinimized() || IsWindowHidden();
     BeginDrawing();
     ClearBackground(COLOR_BACKGROUND);
 
@@ -1752,5 +4113,6 @@ MUSIALIZER_PLUG void plug_update(void) {
 
     end_tooltip_frame();
 
+    idle_update();
     EndDrawing();
 }
@@ -0,0 +1,242 @@
+#ifndef RASTER_H_
+#define RASTER_H_
+
+// Software rasterizer of the bars of a spectrum, for rendering the video without a GPU.
+//
+// It draws the same three layers as the GPU does, the lines, the smears and the circles, with
+// the same geometry and the falloff of circle.fs, right into an RGBA image. A pixel belongs to
+// a shape if its center is inside, like with OpenGL, and the blending is the same as the alpha
+// blending of raylib on the colors. The alpha comes out the way premultiplied blending would
+// have it, so an image that starts out transparent can be drawn with BLEND_ALPHA_PREMULTIPLY.
+//
+// Every call only touches the rows in [row_from, row_to), so any amount of threads can draw
+// into different rows of the same image without any locking. The spans of solid color are
+// filled 4 pixels at a time.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "palette.h"
+
+// 4 bytes per pixel in the order of Palette_Color, the rows top to bottom without padding
+typedef struct {
+    uint8_t *pixels;
+    size_t width;
+    size_t height;
+} Raster_Image;
+
+typedef struct {
+    size_t m;
+    const float *smooth;
+    const float *smear;
+    const Palette_Color *colors;
+    float x, y, width, height; // Boundary in pixels of the image
+    float glow_scale;          // Of the smears and the circles
+} Raster_Spectrum;
+
+void raster_clear(Raster_Image *image, Palette_Color color, size_t row_from, size_t row_to);
+void raster_spectrum(Raster_Image *image, const Raster_Spectrum *s, size_t row_from, size_t row_to);
+
+#endif // RASTER_H_
+
+#if defined(RASTER_IMPLEMENTATION) && !defined(RASTER_IMPLEMENTATION_INCLUDED_)
+#define RASTER_IMPLEMENTATION_INCLUDED_
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#   define RASTER_SSE2
+#   include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#   define RASTER_NEON
+#   include <arm_neon.h>
+#endif
+
+static uint32_t raster_pack(Palette_Color color)
+{
+    uint32_t pixel;
+    memcpy(&pixel, &color, sizeof(pixel));
+    return pixel;
+}
+
+static void raster_fill_span(uint32_t *row, size_t count, uint32_t pixel)
+{
+    uint32_t *end = row + count;
+#if defined(RASTER_SSE2)
+    __m128i x = _mm_set1_epi32((int)pixel);
+    for (; end - row >= 4; row += 4) _mm_storeu_si128((__m128i*)row, x);
+#elif defined(RASTER_NEON)
+    uint32x4_t x = vdupq_n_u32(pixel);
+    for (; end - row >= 4; row += 4) vst1q_u32(row, x);
+#endif
+    while (row < end) *row++ = pixel;
+}
+
+// Blends the color (r, g, b, a) within 0..1 over the pixel
+static void raster_blend(uint8_t *pixel, float r, float g, float b, float a)
+{
+    if (a <= 0.0f) return;
+    float k = 1.0f - a;
+    a *= 255.0f;
+    pixel[0] = (uint8_t)(r*a + pixel[0]*k + 0.5f);
+    pixel[1] = (uint8_t)(g*a + pixel[1]*k + 0.5f);
+    pixel[2] = (uint8_t)(b*a + pixel[2]*k + 0.5f);
+    pixel[3] = (uint8_t)(a + pixel[3]*k + 0.5f);
+}
+
+static float raster_clamp(float x)
+{
+    return x < 0.0f ? 0.0f : x > 1.0f ? 1.0f : x;
+}
+
+// The pixels whose centers are within [from, to), clipped to [0, limit)
+static void raster_range(float from, float to, size_t limit, size_t *first, size_t *end)
+{
+    float a = ceilf(from - 0.5f);
+    float b = ceilf(to - 0.5f);
+    if (a < 0.0f) a = 0.0f;
+    if (b > (float)limit) b = (float)limit;
+    *first = (size_t)a;
+    *end = b > a ? (size_t)b : *first;
+}
+
+typedef struct {
+    float x0, y0, x1, y1; // The quad
+    float v0, v1;         // The texture coordinate at the top and at the bottom
+    float radius;         // Of circle.fs
+    int power;
+} Raster_Quad;
+
+// A quad of circle.fs
+static void raster_circle(Raster_Image *image, const Raster_Quad *q, Palette_Color color, size_t row_from, size_t row_to)
+{
+    if (!(q->x1 > q->x0 && q->y1 > q->y0)) return;
+    size_t x_first, x_end, y_first, y_end;
+    raster_range(q->x0, q->x1, image->width, &x_first, &x_end);
+    raster_range(q->y0, q->y1, row_to, &y_first, &y_end);
+    if (y_first < row_from) y_first = row_from;
+
+    float r = color.r/255.0f, g = color.g/255.0f, b = color.b/255.0f, a = color.a/255.0f;
+    float inner = q->radius;
+    float inv_width = 1.0f/(q->x1 - q->x0);
+    float inv_falloff = 1.0f/(0.5f - inner);
+    // Within the inner radius it's just color*1.5, no need for the square root there
+    float core_r = raster_clamp(1.5f*r), core_g = raster_clamp(1.5f*g), core_b = raster_clamp(1.5f*b);
+    float core_a = raster_clamp(1.5f*a);
+    for (size_t y = y_first; y < y_end; ++y) {
+        float v = q->v0 + (q->v1 - q->v0)*((y + 0.5f - q->y0)/(q->y1 - q->y0));
+        float dv = v - 0.5f;
+        float dv2 = dv*dv;
+        if (dv2 > 0.25f) continue;
+        // Only the part of the row within the circle, a pixel either way for the rounding
+        float half = sqrtf(0.25f - dv2)*(q->x1 - q->x0);
+        float center = 0.5f*(q->x0 + q->x1);
+        size_t from, to;
+        raster_range(center - half - 1.0f, center + half + 1.0f, image->width, &from, &to);
+        if (from < x_first) from = x_first;
+        if (to > x_end) to = x_end;
+
+        uint8_t *row = image->pixels + y*image->width*4;
+        float du = ((float)from + 0.5f - q->x0)*inv_width - 0.5f;
+        for (size_t x = from; x < to; ++x, du += inv_width) {
+            float distance2 = du*du + dv2;
+            if (distance2 > 0.25f) continue;
+            if (distance2 <= inner*inner) {
+                raster_blend(row + x*4, core_r, core_g, core_b, core_a);
+                continue;
+            }
+            float base = 1.0f - (sqrtf(distance2) - inner)*inv_falloff;
+            float t = base;
+            for (int i = 1; i < q->power; ++i) t *= base;
+            // mix(vec4(color.rgb, 0), color*1.5, t)
+            float cr = raster_clamp(r + 0.5f*r*t);
+            float cg = raster_clamp(g + 0.5f*g*t);
+            float cb = raster_clamp(b + 0.5f*b*t);
+            float ca = raster_clamp(1.5f*a*t);
+            raster_blend(row + x*4, cr, cg, cb, ca);
+        }
+    }
+}
+
+void raster_clear(Raster_Image *image, Palette_Color color, size_t row_from, size_t row_to)
+{
+    if (row_to > image->height) row_to = image->height;
+    uint32_t pixel = raster_pack(color);
+    for (size_t y = row_from; y < row_to; ++y) {
+        raster_fill_span((uint32_t*)(image->pixels + y*image->width*4), image->width, pixel);
+    }
+}
+
+void raster_spectrum(Raster_Image *image, const Raster_Spectrum *s, size_t row_from, size_t row_to)
+{
+    if (s->m == 0) return;
+    if (row_to > image->height) row_to = image->height;
+    if (row_from >= row_to) return;
+
+    float cell_width = s->width/s->m;
+    float bottom = s->y + s->height;
+    float height = s->height*2.0f/3.0f;
+
+    // Lines
+    for (size_t i = 0; i < s->m; ++i) {
+        float t = s->smooth[i];
+        float x = s->x + (i + 0.5f)*cell_width;
+        float thick = cell_width/3.0f*sqrtf(t);
+        size_t x_first, x_end, y_first, y_end;
+        raster_range(x - thick/2.0f, x + thick/2.0f, image->width, &x_first, &x_end);
+        raster_range(bottom - height*t, bottom, row_to, &y_first, &y_end);
+        if (y_first < row_from) y_first = row_from;
+        if (x_first >= x_end) continue;
+
+        Palette_Color color = s->colors[i];
+        if (color.a == 255) {
+            uint32_t pixel = raster_pack(color);
+            for (size_t y = y_first; y < y_end; ++y) {
+                raster_fill_span((uint32_t*)(image->pixels + y*image->width*4) + x_first, x_end - x_first, pixel);
+            }
+        } else {
+            for (size_t y = y_first; y < y_end; ++y) {
+                uint8_t *row = image->pixels + y*image->width*4;
+                for (size_t x = x_first; x < x_end; ++x) {
+                    raster_blend(row + x*4, color.r/255.0f, color.g/255.0f, color.b/255.0f, color.a/255.0f);
+                }
+            }
+        }
+    }
+
+    // Smears
+    for (size_t i = 0; i < s->m; ++i) {
+        float t = s->smooth[i];
+        float top = bottom - height*t;
+        float smear = bottom - height*s->smear[i];
+        float x = s->x + (i + 0.5f)*cell_width;
+        float radius = cell_width*3.0f*s->glow_scale*sqrtf(t);
+        // A falling bar leaves the top half of the circle behind, a rising one the bottom half
+        float v0 = top >= smear ? 0.0f : 0.5f;
+        Raster_Quad q = {
+            .x0 = x - radius/2.0f, .x1 = x + radius/2.0f,
+            .y0 = fminf(smear, top), .y1 = fmaxf(smear, top),
+            .v0 = v0, .v1 = v0 + 0.5f,
+            .radius = 0.3f, .power = 3,
+        };
+        raster_circle(image, &q, s->colors[i], row_from, row_to);
+    }
+
+    // Circles
+    for (size_t i = 0; i < s->m; ++i) {
+        float t = s->smooth[i];
+        float x = s->x + (i + 0.5f)*cell_width;
+        float y = bottom - height*t;
+        float radius = cell_width*6.0f*s->glow_scale*sqrtf(t);
+        Raster_Quad q = {
+            .x0 = x - radius, .x1 = x + radius,
+            .y0 = y - radius, .y1 = y + radius,
+            .v0 = 0.0f, .v1 = 1.0f,
+            .radius = 0.07f, .power = 5,
+        };
+        raster_circle(image, &q, s->colors[i], row_from, row_to);
+    }
+}
+
+#endif // RASTER_IMPLEMENTATION
@@ -0,0 +1,179 @@
+#ifndef RING_H_
+#define RING_H_
+
+// Single-producer/single-consumer ring buffer of audio samples.
+//
+// The producer (the audio callback or the offline renderer) appends whole blocks and
+// never waits for anybody: old samples are simply overwritten. The consumer (the
+// analyzer) takes a contiguous snapshot of the latest samples whenever it needs one.
+// That replaces the old approach of memmove-ing the entire analysis window on each
+// incoming sample.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    float *items;
+    size_t capacity;        // Always a power of two
+    volatile uint64_t head; // Amount of samples ever pushed. Written only by the producer.
+} Ring;
+
+// `capacity` is rounded up to the next power of two. Make it noticeably bigger than
+// the snapshots you are going to take so the producer has some room to run ahead.
+bool ring_init(Ring *ring, size_t capacity);
+void ring_free(Ring *ring);
+// Zeroes the samples, but keeps the head where it is
+void ring_clear(Ring *ring);
+
+// Producer side
+void ring_push(Ring *ring, const float *samples, size_t count);
+// Pushes every `stride`-th sample. Useful for picking a single channel out of interleaved frames.
+void ring_push_strided(Ring *ring, const float *samples, size_t count, size_t stride);
+void ring_push_silence(Ring *ring, size_t count);
+
+// Consumer side. Copies the latest `n` samples into `out` oldest first. Returns false if
+// the producer has overwritten part of the snapshot while we were copying it (the copy
+// is still complete, just not perfectly consistent).
+bool ring_snapshot(Ring *ring, float *out, size_t n);
+// Copies `n` samples starting from the absolute position `from` (counted like head) into
+// `out`. For consumers that keep track of what they have already seen. Returns false under
+// the same conditions as ring_snapshot().
+bool ring_read(Ring *ring, uint64_t from, float *out, size_t n);
+// Zero-copy flavor of ring_read(). The samples [from, from + n) are located in at most two
+// contiguous pieces: the returned amount of them starting at `*first`, and the rest at the
+// beginning of ring->items. The producer keeps writing in the meantime, so once you are done
+// with the samples ask ring_valid() whether they were still intact.
+size_t ring_view(Ring *ring, uint64_t from, size_t n, const float **first);
+// Whether the samples starting from `from` have not been overwritten by the producer yet
+bool ring_valid(Ring *ring, uint64_t from);
+
+#endif // RING_H_
+
+// NOTE: sdft.h includes ring.h too, so the implementation must survive being included more
+// than once
+#if defined(RING_IMPLEMENTATION) && !defined(RING_IMPLEMENTATION_INCLUDED_)
+#define RING_IMPLEMENTATION_INCLUDED_
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "atomic.h"
+
+bool ring_init(Ring *ring, size_t capacity)
+{
+    size_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    ring->items = calloc(cap, sizeof(*ring->items));
+    if (ring->items == NULL) return false;
+    ring->capacity = cap;
+    atomic_u64_store(&ring->head, 0);
+    return true;
+}
+
+void ring_free(Ring *ring)
+{
+    free(ring->items);
+    ring->items = NULL;
+    ring->capacity = 0;
+}
+
+void ring_clear(Ring *ring)
+{
+    memset(ring->items, 0, ring->capacity*sizeof(*ring->items));
+}
+
+// Only the tail of a block bigger than the whole ring would survive anyway, so only that much
+// gets written. The head still moves past the whole block.
+static size_t ring_skipped(Ring *ring, size_t count)
+{
+    return count > ring->capacity ? count - ring->capacity : 0;
+}
+
+void ring_push(Ring *ring, const float *samples, size_t count)
+{
+    uint64_t head = ring->head; // We are the only writer of head
+    size_t skip = ring_skipped(ring, count);
+    size_t written = count - skip;
+    size_t mask = ring->capacity - 1;
+    size_t start = (head + skip) & mask;
+    size_t first = ring->capacity - start;
+    if (first > written) first = written;
+
+    memcpy(ring->items + start, samples + skip, first*sizeof(*samples));
+    memcpy(ring->items, samples + skip + first, (written - first)*sizeof(*samples));
+
+    atomic_u64_store(&ring->head, head + count);
+}
+
+void ring_push_strided(Ring *ring, const float *samples, size_t count, size_t stride)
+{
+    uint64_t head = ring->head;
+    size_t skip = ring_skipped(ring, count);
+    size_t written = count - skip;
+    size_t mask = ring->capacity - 1;
+    size_t start = (head + skip) & mask;
+    size_t first = ring->capacity - start;
+    if (first > written) first = written;
+
+    samples += skip*stride;
+    float *dst = ring->items + start;
+    for (size_t i = 0; i < first; ++i) dst[i] = samples[i*stride];
+    samples += first*stride;
+    for (size_t i = 0; i < written - first; ++i) ring->items[i] = samples[i*stride];
+
+    atomic_u64_store(&ring->head, head + count);
+}
+
+void ring_push_silence(Ring *ring, size_t count)
+{
+    uint64_t head = ring->head;
+    size_t skip = ring_skipped(ring, count);
+    size_t written = count - skip;
+    size_t mask = ring->capacity - 1;
+    size_t start = (head + skip) & mask;
+    size_t first = ring->capacity - start;
+    if (first > written) first = written;
+
+    memset(ring->items + start, 0, first*sizeof(*ring->items));
+    memset(ring->items, 0, (written - first)*sizeof(*ring->items));
+
+    atomic_u64_store(&ring->head, head + count);
+}
+
+size_t ring_view(Ring *ring, uint64_t from, size_t n, const float **first)
+{
+    assert(n <= ring->capacity);
+    size_t mask = ring->capacity - 1;
+    size_t start = from & mask;
+    size_t count = ring->capacity - start;
+    if (count > n) count = n;
+    *first = ring->items + start;
+    return count;
+}
+
+bool ring_valid(Ring *ring, uint64_t from)
+{
+    // The producer may only run `capacity` samples ahead of `from` before it starts
+    // overwriting what we are looking at.
+    uint64_t head = atomic_u64_load(&ring->head);
+    return head - from <= ring->capacity;
+}
+
+bool ring_read(Ring *ring, uint64_t from, float *out, size_t n)
+{
+    const float *first;
+    size_t count = ring_view(ring, from, n, &first);
+    memcpy(out, first, count*sizeof(*out));
+    memcpy(out + count, ring->items, (n - count)*sizeof(*out));
+    return ring_valid(ring, from);
+}
+
+bool ring_snapshot(Ring *ring, float *out, size_t n)
+{
+    uint64_t head = atomic_u64_load(&ring->head);
+    return ring_read(ring, head - n, out, n);
+}
+
+#endif // RING_IMPLEMENTATION
@@ -0,0 +1,241 @@
+#ifndef SDFT_H_
+#define SDFT_H_
+
+// Sliding DFT over the bands.
+//
+// Every band gets a DFT of its own, just long enough for a single bin of it to be as wide as
+// the band: L = fft_size/width samples, with the bin k placed on the center of the band. The
+// bin is updated sample by sample with the classic recurrence
+//
+//     X[k] = (X[k] + x[t] - x[t - L])*exp(2pi*i*k/L)
+//
+// Windows that are a sum of cosines turn into a sum of the neighbouring bins in the
+// frequency domain, so a window with `terms` coefficients needs 2*terms - 1 bins per band.
+//
+// The bins are floats kept in planes across the bands, so fft_sdft_slide() runs the recurrence
+// of the same bin of all of the bands at once with the SIMD kernels of fft.h. Every sample
+// still costs 2*terms - 1 complex multiplications per band, so this is only cheaper than an
+// FFT per update when the FFT is big and the hop is small, see analyze_sdft in
+// src_bench/analyzer.c. The rounding errors of adding and then subtracting the same samples
+// pile up in floats, so the bins are recomputed from the ring every SDFT_REPRIME_SAMPLES.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bands.h"
+#include "fft.h"
+#include "ring.h"
+
+#define SDFT_TERMS_MAX 5
+#define SDFT_BINS_MAX (2*SDFT_TERMS_MAX - 1)
+// Amount of samples that go through fft_sdft_slide() at once
+#define SDFT_BLOCK 32
+// How many samples the bins slide over before they are recomputed from the ring. About 24
+// seconds at 44100 Hz, which keeps the drift of the floats way below what the bars can show.
+#define SDFT_REPRIME_SAMPLES (1 << 20)
+
+typedef struct {
+    // The band map the bins were laid out for
+    size_t fft_size;
+    float sample_rate;
+    Bands_Scale scale;
+    size_t count;
+
+    size_t terms;                 // Amount of cosine coefficients of the window
+    float window[SDFT_TERMS_MAX]; // a[0] - a[1]*cos(2pi*t) + a[2]*cos(4pi*t) - ...
+    uint32_t *length;             // DFT length of every band
+    uint32_t length_max;
+    float *gain;                  // Brings the power of every band to the scale of the fft_size FFT
+    // The planes of fft_sdft_slide(): the plane j holds the bin j - (terms - 1) away from the
+    // center of every band. The lanes past count are padding that stays zero.
+    size_t lanes;                 // count rounded up to FFT_BATCH_LANES
+    float *twiddle_re;            // (2*terms - 1)*lanes entries
+    float *twiddle_im;
+    float *re;                    // Same layout as the twiddles
+    float *im;
+    float *in;                    // SDFT_BLOCK samples coming in
+    float *delta;                 // SDFT_BLOCK rows of lanes, the sample coming in minus the leaving one
+    uint64_t head;                // Position in the ring up to which the samples went in
+    uint64_t primed_at;           // head when the bins were last computed from scratch
+    bool primed;                  // Whether head means anything
+} Sdft;
+
+bool sdft_init(Sdft *sdft, const Bands *bands, const float window[], size_t terms);
+void sdft_free(Sdft *sdft);
+// Whether the bins were laid out for this band map and window
+bool sdft_matches(const Sdft *sdft, const Bands *bands, const float window[], size_t terms);
+// Forgets all the samples. The next sdft_update() starts over from the ring.
+void sdft_reset(Sdft *sdft);
+// Slides every band over the samples of the ring up to `head`. Starts over from the latest
+// samples if it has never seen any or has fallen too far behind.
+void sdft_update(Sdft *sdft, Ring *ring, uint64_t head);
+// Linear power of every band into `out`
+void sdft_power(const Sdft *sdft, float out[]);
+
+#endif // SDFT_H_
+
+#ifdef SDFT_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDFT_TAU 6.28318530717958647692
+
+bool sdft_init(Sdft *sdft, const Bands *bands, const float window[], size_t terms)
+{
+    assert(0 < terms && terms <= SDFT_TERMS_MAX);
+    memset(sdft, 0, sizeof(*sdft));
+    sdft->fft_size = bands->fft_size;
+    sdft->sample_rate = bands->sample_rate;
+    sdft->scale = bands->scale;
+    sdft->count = bands->count;
+    sdft->terms = terms;
+    memcpy(sdft->window, window, terms*sizeof(*window));
+
+    size_t count = bands->count;
+    size_t lanes = (count + FFT_BATCH_LANES - 1)/FFT_BATCH_LANES*FFT_BATCH_LANES;
+    size_t bins = (2*terms - 1)*lanes;
+    sdft->lanes = lanes;
+    sdft->length = malloc(count*sizeof(*sdft->length));
+    sdft->gain = malloc(count*sizeof(*sdft->gain));
+    sdft->twiddle_re = malloc(bins*sizeof(*sdft->twiddle_re));
+    sdft->twiddle_im = malloc(bins*sizeof(*sdft->twiddle_im));
+    sdft->re = calloc(bins, sizeof(*sdft->re));
+    sdft->im = calloc(bins, sizeof(*sdft->im));
+    sdft->in = malloc(SDFT_BLOCK*sizeof(*sdft->in));
+    sdft->delta = calloc(SDFT_BLOCK*lanes, sizeof(*sdft->delta));
+    if (sdft->length == NULL || sdft->gain == NULL || sdft->twiddle_re == NULL || sdft->twiddle_im == NULL ||
+        sdft->re == NULL || sdft->im == NULL || sdft->in == NULL || sdft->delta == NULL) {
+        sdft_free(sdft);
+        return false;
+    }
+
+    for (size_t i = 0; i < bins; ++i) {
+        sdft->twiddle_re[i] = 1.0f;
+        sdft->twiddle_im[i] = 0.0f;
+    }
+    size_t n = bands->fft_size;
+    for (size_t b = 0; b < count; ++b) {
+        size_t width = bands->end[b] - bands->start[b];
+        size_t length = n/width;
+        // Center of the band in the bins of this DFT
+        long k = lround((bands->start[b] + bands->end[b] - 1)*0.5*length/n);
+        sdft->length[b] = length;
+        if (sdft->length_max < length) sdft->length_max = length;
+        float ratio = (float)n/length;
+        sdft->gain[b] = ratio*ratio;
+
+        for (size_t j = 0; j < 2*terms - 1; ++j) {
+            long bin = k + (long)j - (long)(terms - 1);
+            double phi = SDFT_TAU*bin/length;
+            sdft->twiddle_re[j*lanes + b] = cos(phi);
+            sdft->twiddle_im[j*lanes + b] = sin(phi);
+        }
+    }
+    return true;
+}
+
+void sdft_free(Sdft *sdft)
+{
+    free(sdft->length);
+    free(sdft->gain);
+    free(sdft->twiddle_re);
+    free(sdft->twiddle_im);
+    free(sdft->re);
+    free(sdft->im);
+    free(sdft->in);
+    free(sdft->delta);
+    memset(sdft, 0, sizeof(*sdft));
+}
+
+bool sdft_matches(const Sdft *sdft, const Bands *bands, const float window[], size_t terms)
+{
+    return sdft->count == bands->count &&
+           sdft->fft_size == bands->fft_size &&
+           sdft->sample_rate == bands->sample_rate &&
+           sdft->scale == bands->scale &&
+           sdft->terms == terms &&
+           memcmp(sdft->window, window, terms*sizeof(*window)) == 0;
+}
+
+void sdft_reset(Sdft *sdft)
+{
+    sdft->primed = false;
+}
+
+// Slides every band over the samples [from, to). The samples that leave the DFTs are taken
+// from the ring too, unless `fresh` says the DFTs were empty at `from`. Then every band only
+// takes in its latest `length` samples before `to`.
+static void sdft_slide(Sdft *sdft, Ring *ring, uint64_t from, uint64_t to, bool fresh)
+{
+    size_t lanes = sdft->lanes;
+    size_t planes = 2*sdft->terms - 1;
+    // NOTE: the positions may wrap around when we start right after the launch, so count the
+    // samples instead of comparing from and to
+    for (uint64_t left = to - from; left > 0;) {
+        size_t count = left < SDFT_BLOCK ? left : SDFT_BLOCK;
+        ring_read(ring, from, sdft->in, count);
+        for (size_t b = 0; b < sdft->count; ++b) {
+            float *d = sdft->delta + b;
+            uint64_t length = sdft->length[b];
+            if (fresh) {
+                for (size_t i = 0; i < count; ++i) {
+                    d[i*lanes] = to - (from + i) <= length ? sdft->in[i] : 0.0f;
+                }
+            } else {
+                const float *out;
+                size_t first = ring_view(ring, from - length, count, &out);
+                for (size_t i = 0; i < first; ++i) d[i*lanes] = sdft->in[i] - out[i];
+                for (size_t i = first; i < count; ++i) d[i*lanes] = sdft->in[i] - ring->items[i - first];
+            }
+        }
+        fft_sdft_slide(sdft->re, sdft->im, sdft->twiddle_re, sdft->twiddle_im, lanes, planes, sdft->delta, count);
+        from += count;
+        left -= count;
+    }
+}
+
+void sdft_update(Sdft *sdft, Ring *ring, uint64_t head)
+{
+    if (sdft->primed && head - sdft->head <= sdft->length_max && head - sdft->primed_at < SDFT_REPRIME_SAMPLES) {
+        sdft_slide(sdft, ring, sdft->head, head, false);
+    } else {
+        // Every band starts out empty and takes in its latest `length` samples
+        size_t bins = (2*sdft->terms - 1)*sdft->lanes;
+        memset(sdft->re, 0, bins*sizeof(*sdft->re));
+        memset(sdft->im, 0, bins*sizeof(*sdft->im));
+        sdft_slide(sdft, ring, head - sdft->length_max, head, true);
+        sdft->primed_at = head;
+    }
+    sdft->head = head;
+    // If the producer overwrote the samples that were leaving the DFTs, the bins are off for
+    // good. Start over next time.
+    sdft->primed = ring_valid(ring, head - sdft->length_max);
+}
+
+void sdft_power(const Sdft *sdft, float out[])
+{
+    size_t terms = sdft->terms;
+    size_t lanes = sdft->lanes;
+    for (size_t b = 0; b < sdft->count; ++b) {
+        // The center bin is in the plane terms - 1. The coefficient r of the window applies to
+        // the bins r planes away from it on both sides.
+        const float *c_re = sdft->re + (terms - 1)*lanes + b;
+        const float *c_im = sdft->im + (terms - 1)*lanes + b;
+        double re = sdft->window[0]*c_re[0];
+        double im = sdft->window[0]*c_im[0];
+        double sign = -0.5;
+        for (size_t r = 1; r < terms; ++r) {
+            long off = (long)(r*lanes);
+            re += sign*sdft->window[r]*((double)c_re[-off] + c_re[off]);
+            im += sign*sdft->window[r]*((double)c_im[-off] + c_im[off]);
+            sign = -sign;
+        }
+        out[b] = (re*re + im*im)*sdft->gain[b];
+    }
+}
+
+#endif // SDFT_IMPLEMENTATION
@@ -0,0 +1,185 @@
+#ifndef SPECTROGRAM_H_
+#define SPECTROGRAM_H_
+
+// On-disk cache of the bands of every video frame of a track.
+//
+// A file is a Spectrogram_Header followed by frames*streams*m bytes: the normalized log power
+// of every band quantized to 0..255, all of the streams of frame 0 first, then frame 1 and so
+// on. The normalized bands are always within 0..1 and only ever seen through the smoothing,
+// so a byte per band is plenty.
+//
+// The files are memory-mapped. Opening one costs the same no matter how long the track is,
+// and only the pages of the frames that are actually looked at are ever read.
+//
+// The file is named after the hash of its key and keeps the key in the header, so a collision
+// of the names is just a miss. The values are stored in the byte order of the machine, the
+// cache is not meant to be moved around.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mapped_file.h"
+
+#define SPECTROGRAM_VERSION 2
+
+// Everything the bands depend on. The meaning of the fields past the content hash is up to
+// the user, they are just compared.
+typedef struct {
+    uint64_t content_hash; // Of the bytes of the audio file
+    uint32_t sample_rate;
+    uint32_t fft_size;
+    uint32_t fps;
+    uint32_t engine;
+    uint32_t window;
+    uint32_t bands_scale;
+    uint32_t bands_aggregate;
+    uint32_t octave_divisions;
+    uint32_t ingest_mode;
+    uint32_t log_mode;
+} Spectrogram_Key;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    Spectrogram_Key key;
+    uint32_t frames;
+    uint32_t streams;
+    uint32_t m;
+    uint32_t reserved;
+} Spectrogram_Header;
+
+typedef struct {
+    Mapped_File *file;
+    Spectrogram_Header *header;
+    uint8_t *bands;
+    size_t frames;
+    size_t streams;
+    size_t m;
+    bool writing; // Created by spectrogram_create() and not finished yet
+} Spectrogram;
+
+// 64-bit FNV-1a
+uint64_t spectrogram_hash(const void *data, size_t size);
+// Formats the path of the file for the key in the directory `dir` into `path`
+void spectrogram_path(char *path, size_t path_size, const char *dir, const Spectrogram_Key *key);
+// Maps the file for reading. Returns false if it's missing, broken or has a different key.
+bool spectrogram_open(Spectrogram *sg, const char *path, const Spectrogram_Key *key);
+// Creates the file for writing. It's only marked valid by spectrogram_close(), so a file that
+// was never finished is ignored by spectrogram_open().
+bool spectrogram_create(Spectrogram *sg, const char *path, const Spectrogram_Key *key, size_t frames, size_t streams, size_t m);
+// Stores the m bands of the stream in the frame. Created spectrograms only.
+void spectrogram_put(Spectrogram *sg, size_t frame, size_t stream, const float bands[]);
+// Loads `count` bands of the stream in the frame into `out`. The ones past m are 0.
+void spectrogram_get(const Spectrogram *sg, size_t frame, size_t stream, float out[], size_t count);
+// Does nothing if the spectrogram is not open
+void spectrogram_close(Spectrogram *sg);
+
+#endif // SPECTROGRAM_H_
+
+#ifdef SPECTROGRAM_IMPLEMENTATION
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(Spectrogram_Key) == 48, "Spectrogram_Key must not have any padding, it is compared with memcmp");
+
+static const char spectrogram_magic[4] = {'M', 'S', 'P', 'G'};
+
+uint64_t spectrogram_hash(const void *data, size_t size)
+{
+    const uint8_t *bytes = data;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+void spectrogram_path(char *path, size_t path_size, const char *dir, const Spectrogram_Key *key)
+{
+    snprintf(path, path_size, "%s/%016llx.spg", dir, (unsigned long long)spectrogram_hash(key, sizeof(*key)));
+}
+
+static void spectrogram_attach(Spectrogram *sg, Mapped_File *file)
+{
+    sg->file = file;
+    sg->header = mapped_file_data(file);
+    sg->bands = (uint8_t*)(sg->header + 1);
+    sg->frames = sg->header->frames;
+    sg->streams = sg->header->streams;
+    sg->m = sg->header->m;
+}
+
+bool spectrogram_open(Spectrogram *sg, const char *path, const Spectrogram_Key *key)
+{
+    memset(sg, 0, sizeof(*sg));
+    Mapped_File *file = mapped_file_open(path);
+    if (file == NULL) return false;
+
+    size_t size = mapped_file_size(file);
+    const Spectrogram_Header *header = mapped_file_data(file);
+    bool ok = size >= sizeof(*header) &&
+              memcmp(header->magic, spectrogram_magic, sizeof(spectrogram_magic)) == 0 &&
+              header->version == SPECTROGRAM_VERSION &&
+              memcmp(&header->key, key, sizeof(*key)) == 0 &&
+              size == sizeof(*header) + (size_t)header->frames*header->streams*header->m;
+    if (!ok) {
+        mapped_file_close(file);
+        return false;
+    }
+    spectrogram_attach(sg, file);
+    return true;
+}
+
+bool spectrogram_create(Spectrogram *sg, const char *path, const Spectrogram_Key *key, size_t frames, size_t streams, size_t m)
+{
+    memset(sg, 0, sizeof(*sg));
+    Mapped_File *file = mapped_file_create(path, sizeof(Spectrogram_Header) + frames*streams*m);
+    if (file == NULL) return false;
+
+    Spectrogram_Header *header = mapped_file_data(file);
+    memset(header, 0, sizeof(*header));
+    header->version = SPECTROGRAM_VERSION;
+    header->key = *key;
+    header->frames = frames;
+    header->streams = streams;
+    header->m = m;
+    spectrogram_attach(sg, file);
+    sg->writing = true;
+    return true;
+}
+
+void spectrogram_put(Spectrogram *sg, size_t frame, size_t stream, const float bands[])
+{
+    assert(sg->writing);
+    assert(frame < sg->frames && stream < sg->streams);
+    uint8_t *out = sg->bands + (frame*sg->streams + stream)*sg->m;
+    for (size_t i = 0; i < sg->m; ++i) {
+        float x = bands[i];
+        if (!(x > 0.0f)) x = 0.0f;
+        if (x > 1.0f) x = 1.0f;
+        out[i] = (uint8_t)(x*255.0f + 0.5f);
+    }
+}
+
+void spectrogram_get(const Spectrogram *sg, size_t frame, size_t stream, float out[], size_t count)
+{
+    assert(frame < sg->frames && stream < sg->streams);
+    const uint8_t *in = sg->bands + (frame*sg->streams + stream)*sg->m;
+    size_t m = count < sg->m ? count : sg->m;
+    for (size_t i = 0; i < m; ++i) out[i] = in[i]*(1.0f/255.0f);
+    for (size_t i = m; i < count; ++i) out[i] = 0.0f;
+}
+
+void spectrogram_close(Spectrogram *sg)
+{
+    if (sg->file == NULL) return;
+    if (sg->writing) memcpy(sg->header->magic, spectrogram_magic, sizeof(spectrogram_magic));
+    mapped_file_close(sg->file);
+    memset(sg, 0, sizeof(*sg));
+}
+
+#endif // SPECTROGRAM_IMPLEMENTATION
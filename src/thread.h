@@ -0,0 +1,20 @@
+#ifndef THREAD_H_
+#define THREAD_H_
+
+// Minimal threading API. Implemented in thread_posix.c and thread_windows.c, because
+// <windows.h> can't be included next to <raylib.h>.
+
+#include <stddef.h>
+
+typedef struct Thread Thread;
+typedef void (Thread_Proc)(void *arg);
+
+// Returns NULL if the thread could not be started
+Thread *thread_start(Thread_Proc *proc, void *arg);
+// Waits for the thread to finish and frees it
+void thread_join(Thread *thread);
+void thread_sleep(double seconds);
+// Amount of logical processors available to us. At least 1.
+size_t thread_cpu_count(void);
+
+#endif // THREAD_H_
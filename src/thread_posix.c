@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include <raylib.h>
+#include "thread.h"
+
+struct Thread {
+    pthread_t handle;
+    Thread_Proc *proc;
+    void *arg;
+};
+
+static void *thread_entry(void *arg)
+{
+    Thread *thread = arg;
+    thread->proc(thread->arg);
+    return NULL;
+}
+
+Thread *thread_start(Thread_Proc *proc, void *arg)
+{
+    Thread *thread = malloc(sizeof(*thread));
+    if (thread == NULL) return NULL;
+    thread->proc = proc;
+    thread->arg = arg;
+
+    int err = pthread_create(&thread->handle, NULL, thread_entry, thread);
+    if (err != 0) {
+        TraceLog(LOG_ERROR, "THREAD: could not start a thread: %s", strerror(err));
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(Thread *thread)
+{
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+void thread_sleep(double seconds)
+{
+    if (seconds <= 0) return;
+    struct timespec ts;
+    ts.tv_sec = (time_t)seconds;
+    ts.tv_nsec = (long)((seconds - (double)ts.tv_sec)*1e9);
+    while (nanosleep(&ts, &ts) != 0) {}
+}
+
+size_t thread_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+}
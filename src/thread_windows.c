@@ -0,0 +1,61 @@
+#include <stdlib.h>
+
+#define WIN32_LEAN_AND_MEAN
+#define _WINUSER_
+#define _WINGDI_
+#define _IMM_
+#define _WINCON_
+#include <windows.h>
+
+#include <raylib.h>
+#include "thread.h"
+
+struct Thread {
+    HANDLE handle;
+    Thread_Proc *proc;
+    void *arg;
+};
+
+static DWORD WINAPI thread_entry(LPVOID arg)
+{
+    Thread *thread = arg;
+    thread->proc(thread->arg);
+    return 0;
+}
+
+Thread *thread_start(Thread_Proc *proc, void *arg)
+{
+    Thread *thread = malloc(sizeof(*thread));
+    if (thread == NULL) return NULL;
+    thread->proc = proc;
+    thread->arg = arg;
+
+    thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        TraceLog(LOG_ERROR, "THREAD: could not start a thread. System Error Code: %d", GetLastError());
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(Thread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+void thread_sleep(double seconds)
+{
+    if (seconds <= 0) return;
+    // NOTE: raylib bumps the timer resolution to 1ms with timeBeginPeriod(), so this is accurate enough
+    Sleep((DWORD)(seconds*1000.0));
+}
+
+size_t thread_cpu_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (size_t)info.dwNumberOfProcessors : 1;
+}
@@ -0,0 +1,56 @@
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+// Lock-free triple buffering of three user-owned slots between one writer and one reader.
+//
+// The writer always fills the back slot and publishes it by swapping it with the middle
+// one. The reader swaps the middle slot with its front slot only when there is something
+// fresh there. Nobody ever waits, and the reader always sees the latest complete slot.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "atomic.h"
+
+#define TRIPLE_BUFFER_FRESH 4
+
+typedef struct {
+    volatile uint32_t middle; // Slot index | TRIPLE_BUFFER_FRESH if it was not read yet
+    uint32_t back;            // Owned by the writer
+    uint32_t front;           // Owned by the reader
+} Triple_Buffer;
+
+static inline void triple_buffer_init(Triple_Buffer *tb)
+{
+    tb->front = 0;
+    tb->back = 2;
+    atomic_u32_store(&tb->middle, 1);
+}
+
+// Writer side. The slot to fill before calling triple_buffer_publish()
+static inline uint32_t triple_buffer_back(const Triple_Buffer *tb)
+{
+    return tb->back;
+}
+
+static inline void triple_buffer_publish(Triple_Buffer *tb)
+{
+    tb->back = atomic_u32_exchange(&tb->middle, tb->back | TRIPLE_BUFFER_FRESH) & 3;
+}
+
+// Reader side. Returns the slot with the latest published data
+static inline uint32_t triple_buffer_front(Triple_Buffer *tb)
+{
+    if (atomic_u32_load(&tb->middle) & TRIPLE_BUFFER_FRESH) {
+        tb->front = atomic_u32_exchange(&tb->middle, tb->front) & 3;
+    }
+    return tb->front;
+}
+
+// Reader side. Whether anything was published since the last triple_buffer_front()
+static inline bool triple_buffer_fresh(Triple_Buffer *tb)
+{
+    return (atomic_u32_load(&tb->middle) & TRIPLE_BUFFER_FRESH) != 0;
+}
+
+#endif // TRIPLE_BUFFER_H_
@@ -0,0 +1,179 @@
+#ifndef WINDOW_H_
+#define WINDOW_H_
+
+// Window functions for the spectrum analysis.
+//
+// Computing a window takes a bunch of cosf() calls per sample, so the tables are computed once
+// per kind and size and kept in a Window_Cache. The cache is a plain struct owned by the user,
+// so it survives the hot reload together with the rest of the state.
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    WINDOW_HANN,
+    WINDOW_HAMMING,
+    WINDOW_BLACKMAN_HARRIS,
+    WINDOW_FLAT_TOP,
+    WINDOW_KAISER,
+    COUNT_WINDOWS,
+} Window_Kind;
+
+// Kaiser window shape parameter. 8.6 puts the side lobes roughly where Blackman has them.
+#define WINDOW_KAISER_BETA 8.6f
+
+typedef struct {
+    Window_Kind kind;
+    size_t n;
+    float *table;
+} Window_Table;
+
+typedef struct {
+    Window_Table *items;
+    size_t count;
+    size_t capacity;
+} Window_Cache;
+
+const char *window_name(Window_Kind kind);
+// Computes the symmetric window of size n into `out`
+void window_fill(Window_Kind kind, float out[], size_t n);
+// Coefficients of the windows that are a sum of cosines a[0] - a[1]*cos(2pi*t) + a[2]*cos(4pi*t) - ...
+// Returns the amount of them, or 0 if the window is not a sum of cosines.
+size_t window_cosine_terms(Window_Kind kind, const float **a);
+// Returns the table for `kind` of size n, computing it if it's not in the cache yet.
+// Returns NULL if it could not be allocated.
+const float *window_cache_get(Window_Cache *cache, Window_Kind kind, size_t n);
+void window_cache_free(Window_Cache *cache);
+
+#endif // WINDOW_H_
+
+#ifdef WINDOW_IMPLEMENTATION
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef PI
+#define PI 3.14159265358979323846f
+#endif // PI
+
+const char *window_name(Window_Kind kind)
+{
+    switch (kind) {
+    case WINDOW_HANN:            return "Hann";
+    case WINDOW_HAMMING:         return "Hamming";
+    case WINDOW_BLACKMAN_HARRIS: return "Blackman-Harris";
+    case WINDOW_FLAT_TOP:        return "Flat-top";
+    case WINDOW_KAISER:          return "Kaiser";
+    default:                     return "Unknown";
+    }
+}
+
+// Zeroth order modified Bessel function of the first kind
+static double window_bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64; ++k) {
+        term *= (x/(2*k))*(x/(2*k));
+        sum += term;
+        if (term < sum*1e-12) break;
+    }
+    return sum;
+}
+
+static const float window_hann[]            = {0.5f, 0.5f};
+static const float window_hamming[]         = {0.54f, 0.46f};
+static const float window_blackman_harris[] = {0.35875f, 0.48829f, 0.14128f, 0.01168f};
+static const float window_flat_top[]        = {0.21557895f, 0.41663158f, 0.277263158f, 0.083578947f, 0.006947368f};
+
+size_t window_cosine_terms(Window_Kind kind, const float **a)
+{
+    switch (kind) {
+    case WINDOW_HANN:            *a = window_hann;            return 2;
+    case WINDOW_HAMMING:         *a = window_hamming;         return 2;
+    case WINDOW_BLACKMAN_HARRIS: *a = window_blackman_harris; return 4;
+    case WINDOW_FLAT_TOP:        *a = window_flat_top;        return 5;
+    default:                     *a = NULL;                   return 0;
+    }
+}
+
+// Sum of cosines a[0] - a[1]*cos(2pi*t) + a[2]*cos(4pi*t) - ...
+static float window_cosine_sum(const float a[], size_t count, float t)
+{
+    float w = 0.0f;
+    float sign = 1.0f;
+    for (size_t k = 0; k < count; ++k) {
+        w += sign*a[k]*cosf(2*PI*k*t);
+        sign = -sign;
+    }
+    return w;
+}
+
+void window_fill(Window_Kind kind, float out[], size_t n)
+{
+    if (n == 1) {
+        out[0] = 1.0f;
+        return;
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        float t = (float)i/(n - 1);
+        switch (kind) {
+        case WINDOW_HANN:
+            // NOTE: not window_cosine_sum() so it stays exactly what Musializer always used
+            out[i] = 0.5 - 0.5*cosf(2*PI*t);
+            break;
+        case WINDOW_HAMMING:
+            out[i] = window_cosine_sum(window_hamming, 2, t);
+            break;
+        case WINDOW_BLACKMAN_HARRIS:
+            out[i] = window_cosine_sum(window_blackman_harris, 4, t);
+            break;
+        case WINDOW_FLAT_TOP:
+            out[i] = window_cosine_sum(window_flat_top, 5, t);
+            break;
+        case WINDOW_KAISER: {
+            double r = 2.0*t - 1.0;
+            out[i] = window_bessel_i0(WINDOW_KAISER_BETA*sqrt(1.0 - r*r))/window_bessel_i0(WINDOW_KAISER_BETA);
+        } break;
+        default:
+            assert(0 && "unreachable");
+        }
+    }
+}
+
+const float *window_cache_get(Window_Cache *cache, Window_Kind kind, size_t n)
+{
+    for (size_t i = 0; i < cache->count; ++i) {
+        if (cache->items[i].kind == kind && cache->items[i].n == n) return cache->items[i].table;
+    }
+
+    if (cache->count >= cache->capacity) {
+        size_t capacity = cache->capacity == 0 ? 8 : cache->capacity*2;
+        Window_Table *items = realloc(cache->items, capacity*sizeof(*items));
+        if (items == NULL) return NULL;
+        cache->items = items;
+        cache->capacity = capacity;
+    }
+
+    float *table = malloc(n*sizeof(*table));
+    if (table == NULL) return NULL;
+    window_fill(kind, table, n);
+    cache->items[cache->count++] = (Window_Table) {
+        .kind = kind,
+        .n = n,
+        .table = table,
+    };
+    return table;
+}
+
+void window_cache_free(Window_Cache *cache)
+{
+    for (size_t i = 0; i < cache->count; ++i) free(cache->items[i].table);
+    free(cache->items);
+    memset(cache, 0, sizeof(*cache));
+}
+
+#endif // WINDOW_IMPLEMENTATION
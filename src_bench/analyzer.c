@@ -0,0 +1,313 @@
+// Measures the building blocks of the spectrum analysis and the whole analysis step of every
+// engine over several FFT sizes and synthetic inputs.
+//
+//   $ cc -O2 -I. -o build/bench_analyzer src_bench/analyzer.c -lm
+//   $ ./build/bench_analyzer [results.csv]
+//
+// or just `./nob bench`.
+//
+// Every case steps through the same signal one video frame (a hop of SIGNAL_HOP samples) at
+// a time. The analyze_* cases run once more with hops of SMALL_HOP samples, FFT_HOP_DEFAULT of
+// src/plug.c, and are reported with the hop after the name:
+//
+//   window       fft_window() of the latest n samples
+//   fft          fft_real_execute() of n samples
+//   fft_batch    fft_batch_execute() of n samples of BATCH_STREAMS streams at once, the way the
+//                stems are analyzed. Compare with BATCH_STREAMS times fft.
+//   log_exact    fft_log() of the n/2 bins, the way multires squashes every level
+//   log_fast     same with the fast approximation
+//   squash       bands_aggregate() of the n/2 bins followed by fft_log() of the bands
+//   analyze_*    everything fft_analyze_bands() in src/plug.c does for the engine, from the
+//                samples in the ring to the normalized bands
+//
+// The allocations are counted inside of the timed loops only, so anything but 0 means somebody
+// started allocating per frame.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "src_bench/bench.h"
+
+#define malloc(size) bench_malloc(size)
+#define calloc(count, size) bench_calloc(count, size)
+#define realloc(ptr, size) bench_realloc(ptr, size)
+
+#define FFT_IMPLEMENTATION
+#include "src/fft.h"
+#define RING_IMPLEMENTATION
+#include "src/ring.h"
+#define BANDS_IMPLEMENTATION
+#include "src/bands.h"
+#define WINDOW_IMPLEMENTATION
+#include "src/window.h"
+#define MULTIRES_IMPLEMENTATION
+#include "src/multires.h"
+#define SDFT_IMPLEMENTATION
+#include "src/sdft.h"
+
+#undef malloc
+#undef calloc
+#undef realloc
+
+#define SAMPLE_RATE 44100
+// 60 video frames per second, like the rendering
+#define SIGNAL_HOP (SAMPLE_RATE/60)
+#define SMALL_HOP 256
+#define SIGNAL_FRAMES 300
+#define OCTAVE_DIVISIONS 12
+#define BATCH_STREAMS 4
+
+static const size_t sizes[] = {1 << 10, 1 << 12, 1 << 14, 1 << 16};
+
+typedef enum {
+    INPUT_SWEEP,
+    INPUT_NOISE,
+    INPUT_SILENCE,
+    COUNT_INPUTS,
+} Input;
+
+static const char *input_names[COUNT_INPUTS] = {"sweep", "noise", "silence"};
+
+// The biggest FFT worth of history, a few hops for the older windows of fft_batch and then
+// SIGNAL_FRAMES hops
+static float signal[(1 << 16) + BATCH_STREAMS*SIGNAL_HOP + SIGNAL_FRAMES*SIGNAL_HOP];
+#define SIGNAL_LEN (sizeof(signal)/sizeof(signal[0]))
+
+static void generate_input(Input input)
+{
+    switch (input) {
+    case INPUT_SWEEP: {
+        // Exponential sweep from 20Hz to 20kHz over the whole signal
+        double f0 = 20.0, f1 = 20000.0;
+        double duration = (double)SIGNAL_LEN/SAMPLE_RATE;
+        double k = log(f1/f0)/duration;
+        for (size_t i = 0; i < SIGNAL_LEN; ++i) {
+            double t = (double)i/SAMPLE_RATE;
+            signal[i] = 0.5f*sin(2.0*PI*f0*(exp(k*t) - 1.0)/k);
+        }
+    } break;
+    case INPUT_NOISE: {
+        uint32_t seed = 69;
+        for (size_t i = 0; i < SIGNAL_LEN; ++i) signal[i] = 0.5f*bench_noise(&seed);
+    } break;
+    case INPUT_SILENCE:
+        memset(signal, 0, sizeof(signal));
+        break;
+    default:
+        abort();
+    }
+}
+
+typedef enum {
+    CASE_WINDOW,
+    CASE_FFT,
+    CASE_FFT_BATCH,
+    CASE_LOG_EXACT,
+    CASE_LOG_FAST,
+    CASE_SQUASH,
+    CASE_ANALYZE_FFT,
+    CASE_ANALYZE_MULTIRES,
+    CASE_ANALYZE_SDFT,
+    COUNT_CASES,
+} Case;
+
+static const char *case_names[COUNT_CASES] = {
+    "window", "fft", "fft_batch", "log_exact", "log_fast", "squash", "analyze_fft", "analyze_multires", "analyze_sdft",
+};
+
+typedef struct {
+    size_t n;
+    float *window;        // n entries
+    float *window_level;  // MULTIRES_LEVEL_SIZE_DEFAULT entries
+    FFT_Real_Plan plan;
+    FFT_Batch batch;
+    Float_Complex *batch_out; // BATCH_STREAMS*(n/2 + 1) entries
+    float *in_win;
+    Float_Complex *out_raw;
+    float *out_power;
+    float *out_log;
+    Bands bands;
+    Multires multires;
+    Sdft sdft;
+    Ring ring;
+} Analyzer;
+
+static bool analyzer_init(Analyzer *a, size_t n)
+{
+    memset(a, 0, sizeof(*a));
+    a->n = n;
+    size_t level_size = n < MULTIRES_LEVEL_SIZE_DEFAULT ? n : MULTIRES_LEVEL_SIZE_DEFAULT;
+    const float *cosines;
+    size_t terms = window_cosine_terms(WINDOW_HANN, &cosines);
+    a->window = malloc(n*sizeof(*a->window));
+    a->window_level = malloc(level_size*sizeof(*a->window_level));
+    a->in_win = malloc(n*sizeof(*a->in_win));
+    a->out_raw = malloc((n/2 + 1)*sizeof(*a->out_raw));
+    a->out_power = malloc((n/2 + 1)*sizeof(*a->out_power));
+    a->out_log = malloc(n/2*sizeof(*a->out_log));
+    a->batch_out = malloc(BATCH_STREAMS*(n/2 + 1)*sizeof(*a->batch_out));
+    if (!a->window || !a->window_level || !a->in_win || !a->out_raw || !a->out_power || !a->out_log || !a->batch_out) return false;
+    if (!fft_real_plan_init(&a->plan, n)) return false;
+    if (!fft_batch_init(&a->batch, n, BATCH_STREAMS)) return false;
+    if (!bands_init(&a->bands, n, SAMPLE_RATE, BANDS_SCALE_LOG, OCTAVE_DIVISIONS)) return false;
+    if (!multires_init(&a->multires, n, MULTIRES_LEVEL_SIZE_DEFAULT)) return false;
+    if (!sdft_init(&a->sdft, &a->bands, cosines, terms)) return false;
+    if (!ring_init(&a->ring, 2*n)) return false;
+    window_fill(WINDOW_HANN, a->window, n);
+    window_fill(WINDOW_HANN, a->window_level, level_size);
+    return true;
+}
+
+static void analyzer_free(Analyzer *a)
+{
+    free(a->window);
+    free(a->window_level);
+    free(a->in_win);
+    free(a->out_raw);
+    free(a->out_power);
+    free(a->out_log);
+    free(a->batch_out);
+    fft_real_plan_free(&a->plan);
+    fft_batch_free(&a->batch);
+    bands_free(&a->bands);
+    multires_free(&a->multires);
+    sdft_free(&a->sdft);
+    ring_free(&a->ring);
+}
+
+// The same steps as fft_analyze_bands() in src/plug.c with the default settings
+static void analyze(Analyzer *a, Case c, size_t hop)
+{
+    size_t n = a->n;
+    uint64_t head = a->ring.head;
+    size_t m = a->bands.count;
+    switch (c) {
+    case CASE_ANALYZE_FFT: {
+        const float *first;
+        size_t count = ring_view(&a->ring, head - n, n, &first);
+        fft_window(first, a->window, a->in_win, count);
+        fft_window(a->ring.items, a->window + count, a->in_win + count, n - count);
+        fft_real_execute(&a->plan, a->in_win, a->out_raw);
+        fft_power(a->out_raw, a->out_power, n/2);
+        bands_aggregate(&a->bands, a->out_power, a->out_log, BANDS_AGGREGATE_MAX);
+        fft_log(a->out_log, a->out_log, m, FFT_LOG_FAST);
+    } break;
+    case CASE_ANALYZE_MULTIRES: {
+        const float *first;
+        size_t count = ring_view(&a->ring, head - hop, hop, &first);
+        multires_push(&a->multires, first, count);
+        multires_push(&a->multires, a->ring.items, hop - count);
+        multires_execute(&a->multires, a->window_level, FFT_LOG_FAST);
+        for (size_t i = 0; i < m; ++i) {
+            a->out_log[i] = multires_band(&a->multires, a->bands.start[i], a->bands.end[i]);
+        }
+    } break;
+    case CASE_ANALYZE_SDFT: {
+        sdft_update(&a->sdft, &a->ring, head);
+        sdft_power(&a->sdft, a->out_log);
+        fft_log(a->out_log, a->out_log, m, FFT_LOG_FAST);
+    } break;
+    default:
+        abort();
+    }
+
+    float max_amp = 1.0f;
+    for (size_t i = 0; i < m; ++i) {
+        if (!(a->out_log[i] > 0.0f)) a->out_log[i] = 0.0f;
+        if (max_amp < a->out_log[i]) max_amp = a->out_log[i];
+    }
+    for (size_t i = 0; i < m; ++i) a->out_log[i] /= max_amp;
+}
+
+static void run_case(Analyzer *a, Case c, Input input, size_t hop)
+{
+    size_t n = a->n;
+    size_t history = SIGNAL_LEN - SIGNAL_FRAMES*SIGNAL_HOP;
+
+    // The state of the stateful engines starts from the samples right before the first frame
+    ring_clear(&a->ring);
+    ring_push(&a->ring, signal + history - n, n);
+    multires_reset(&a->multires);
+    multires_push(&a->multires, signal + history - n, n);
+    sdft_reset(&a->sdft);
+    sdft_update(&a->sdft, &a->ring, a->ring.head);
+    // The power spectrum the log and squash cases work on
+    fft_window(signal + history - n, a->window, a->in_win, n);
+    fft_real_execute(&a->plan, a->in_win, a->out_raw);
+    fft_power(a->out_raw, a->out_power, n/2);
+
+    bench_allocs = 0;
+    uint64_t start = bench_now_ns();
+    for (size_t frame = 0; frame < SIGNAL_FRAMES; ++frame) {
+        const float *latest = signal + history + (frame + 1)*hop - n;
+        switch (c) {
+        case CASE_WINDOW:
+            fft_window(latest, a->window, a->in_win, n);
+            break;
+        case CASE_FFT:
+            fft_real_execute(&a->plan, latest, a->out_raw);
+            break;
+        case CASE_FFT_BATCH: {
+            // Every stream gets a different stretch of the signal
+            const float *in[BATCH_STREAMS];
+            Float_Complex *out[BATCH_STREAMS];
+            for (size_t s = 0; s < BATCH_STREAMS; ++s) {
+                in[s] = latest - s*SIGNAL_HOP;
+                out[s] = a->batch_out + s*(n/2 + 1);
+            }
+            fft_batch_execute(&a->batch, in, out, BATCH_STREAMS);
+        } break;
+        case CASE_LOG_EXACT:
+            fft_log(a->out_power, a->out_log, n/2, FFT_LOG_EXACT);
+            break;
+        case CASE_LOG_FAST:
+            fft_log(a->out_power, a->out_log, n/2, FFT_LOG_FAST);
+            break;
+        case CASE_SQUASH:
+            bands_aggregate(&a->bands, a->out_power, a->out_log, BANDS_AGGREGATE_MAX);
+            fft_log(a->out_log, a->out_log, a->bands.count, FFT_LOG_FAST);
+            break;
+        default:
+            ring_push(&a->ring, latest + n - hop, hop);
+            analyze(a, c, hop);
+        }
+    }
+    uint64_t ns = bench_now_ns() - start;
+    size_t allocs = bench_allocs;
+    bench_sink = a->out_log[0] + a->in_win[n/2] + crealf(a->out_raw[1]) + crealf(a->batch_out[1]);
+
+    // The cases that don't consume new samples still work on a frame's worth of them
+    size_t samples = c >= CASE_ANALYZE_FFT ? hop : c == CASE_FFT_BATCH ? BATCH_STREAMS*n : n;
+    char name[32];
+    if (hop == SIGNAL_HOP) {
+        snprintf(name, sizeof(name), "%s", case_names[c]);
+    } else {
+        snprintf(name, sizeof(name), "%s/%zu", case_names[c], hop);
+    }
+    bench_report("analyzer", name, input_names[input], n, ns, SIGNAL_FRAMES, samples, allocs);
+}
+
+int main(int argc, char **argv)
+{
+    if (!bench_open_results(argc, argv)) return 1;
+    fft_kernels_select(fft_kernels_best());
+    printf("kernels: %s\n", fft_kernels_name(fft_kernels_current()));
+
+    for (size_t i = 0; i < sizeof(sizes)/sizeof(sizes[0]); ++i) {
+        Analyzer a;
+        if (!analyzer_init(&a, sizes[i])) {
+            fprintf(stderr, "ERROR: could not allocate the analyzer of size %zu\n", sizes[i]);
+            return 1;
+        }
+        for (Input input = 0; input < COUNT_INPUTS; ++input) {
+            generate_input(input);
+            for (Case c = 0; c < COUNT_CASES; ++c) run_case(&a, c, input, SIGNAL_HOP);
+            for (Case c = CASE_ANALYZE_FFT; c < COUNT_CASES; ++c) run_case(&a, c, input, SMALL_HOP);
+        }
+        analyzer_free(&a);
+    }
+
+    bench_close_results();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+// Tiny helpers shared by the microbenchmarks in this folder.
+// The benchmarks do not depend on raylib so they can include platform headers freely.
+//
+// Every benchmark prints a line per case. If it gets a file path as the first argument it
+// also appends the results to that file as CSV, which is how `./nob bench` collects them into
+// build/bench.csv. A "frame" is whatever one step of the benchmark is: an analysis of a video
+// frame, an audio frame pushed by the callback, etc.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   include <windows.h>
+static inline uint64_t bench_now_ns(void)
+{
+    static LARGE_INTEGER freq = {0};
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (uint64_t)((double)now.QuadPart*1e9/(double)freq.QuadPart);
+}
+#else
+#   include <time.h>
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000*1000*1000 + (uint64_t)ts.tv_nsec;
+}
+#endif // _WIN32
+
+// Keeps the compiler from optimizing away the work we are trying to measure
+static volatile float bench_sink;
+
+// Deterministic xorshift noise in [-1, 1], so runs are comparable between builds
+static inline float bench_noise(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (float)x/(float)UINT32_MAX*2.0f - 1.0f;
+}
+
+#define BENCH_CSV_HEADER "bench,case,input,size,ns_per_frame,samples_per_sec,allocs_per_frame\n"
+
+static FILE *bench_results = NULL;
+
+// Opens the results file from the command line, if there is one. Writes the header if the
+// file is empty.
+static inline bool bench_open_results(int argc, char **argv)
+{
+    if (argc < 2) return true;
+    bench_results = fopen(argv[1], "a");
+    if (bench_results == NULL) {
+        fprintf(stderr, "ERROR: could not open %s\n", argv[1]);
+        return false;
+    }
+    fseek(bench_results, 0, SEEK_END);
+    if (ftell(bench_results) == 0) fputs(BENCH_CSV_HEADER, bench_results);
+    return true;
+}
+
+static inline void bench_close_results(void)
+{
+    if (bench_results) fclose(bench_results);
+    bench_results = NULL;
+}
+
+// `ns` is the total time of `frames` frames of `samples` samples each
+static inline void bench_report(const char *bench, const char *name, const char *input, size_t size,
+                                uint64_t ns, size_t frames, size_t samples, size_t allocs)
+{
+    double ns_per_frame = (double)ns/frames;
+    double samples_per_sec = ns > 0 ? (double)frames*samples*1e9/ns : 0.0;
+    double allocs_per_frame = (double)allocs/frames;
+    printf("%-8s %-20s %-6s %6zu %12.1f ns/frame %10.2f Msamples/s %6.2f allocs/frame\n",
+           bench, name, input, size, ns_per_frame, samples_per_sec/1e6, allocs_per_frame);
+    if (bench_results) {
+        fprintf(bench_results, "%s,%s,%s,%zu,%.1f,%.0f,%.3f\n",
+                bench, name, input, size, ns_per_frame, samples_per_sec, allocs_per_frame);
+    }
+}
+
+// Allocations made by the modules under test. To count them, define
+//
+//     #define malloc(size) bench_malloc(size)
+//     #define calloc(count, size) bench_calloc(count, size)
+//     #define realloc(ptr, size) bench_realloc(ptr, size)
+//
+// after this header and before the implementations of the modules.
+static size_t bench_allocs = 0;
+
+static inline void *bench_malloc(size_t size)
+{
+    bench_allocs += 1;
+    return malloc(size);
+}
+
+static inline void *bench_calloc(size_t count, size_t size)
+{
+    bench_allocs += 1;
+    return calloc(count, size);
+}
+
+static inline void *bench_realloc(void *ptr, size_t size)
+{
+    bench_allocs += 1;
+    return realloc(ptr, size);
+}
+
+#endif // BENCH_H_
@@ -0,0 +1,126 @@
+// Measures how much it costs the audio thread to hand samples over to the analyzer.
+//
+//   $ cc -O2 -I. -o build/bench_ingest src_bench/ingest.c -lm
+//   $ ./build/bench_ingest [results.csv]
+//
+// or just `./nob bench`.
+//
+// "memmove" is the old fft_push() that shifted the entire analysis window on every
+// sample. "ring" is ring_push_strided() from src/ring.h that the callback used to take only
+// the left channel. "mono", "left/right" and "mid/side" go through ingest_frames() from
+// src/ingest.h like the callback does now, and push every resulting stream into its own ring.
+// "decimate x2" and "decimate x4" are the mono mode followed by decimator_process() from
+// src/decimator.h, what the callback does for the 88.2kHz/96kHz and 176.4kHz/192kHz sources.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_IMPLEMENTATION
+#include "src/ring.h"
+#define INGEST_IMPLEMENTATION
+#include "src/ingest.h"
+#define DECIMATOR_IMPLEMENTATION
+#include "src/decimator.h"
+#include "src_bench/bench.h"
+
+#define FFT_SIZE (1 << 15)
+#define CHANNELS 2
+// Roughly what raylib hands to the stream processors at 44.1kHz
+#define BLOCK_FRAMES 1024
+#define TOTAL_FRAMES (44100*10)
+
+static float window[FFT_SIZE];
+
+static void memmove_push(float frame)
+{
+    memmove(window, window + 1, (FFT_SIZE - 1)*sizeof(window[0]));
+    window[FFT_SIZE - 1] = frame;
+}
+
+int main(int argc, char **argv)
+{
+    if (!bench_open_results(argc, argv)) return 1;
+
+    static float block[BLOCK_FRAMES*CHANNELS];
+    uint32_t seed = 69;
+    for (size_t i = 0; i < BLOCK_FRAMES*CHANNELS; ++i) block[i] = bench_noise(&seed);
+
+    uint64_t start = bench_now_ns();
+    for (size_t frames = 0; frames < TOTAL_FRAMES; frames += BLOCK_FRAMES) {
+        for (size_t i = 0; i < BLOCK_FRAMES; ++i) memmove_push(block[i*CHANNELS]);
+    }
+    bench_sink = window[FFT_SIZE/2];
+    uint64_t memmove_ns = bench_now_ns() - start;
+
+    Ring ring = {0};
+    if (!ring_init(&ring, 2*FFT_SIZE)) {
+        fprintf(stderr, "ERROR: could not allocate the ring\n");
+        return 1;
+    }
+    start = bench_now_ns();
+    for (size_t frames = 0; frames < TOTAL_FRAMES; frames += BLOCK_FRAMES) {
+        ring_push_strided(&ring, block, BLOCK_FRAMES, CHANNELS);
+    }
+    bench_sink = ring.items[FFT_SIZE/2];
+    uint64_t ring_ns = bench_now_ns() - start;
+
+    Ring rings[INGEST_STREAMS_MAX] = {0};
+    for (size_t i = 0; i < INGEST_STREAMS_MAX; ++i) {
+        if (!ring_init(&rings[i], 2*FFT_SIZE)) {
+            fprintf(stderr, "ERROR: could not allocate the ring\n");
+            return 1;
+        }
+    }
+    static float streams[INGEST_STREAMS_MAX][BLOCK_FRAMES];
+    float *out[INGEST_STREAMS_MAX] = {streams[0], streams[1]};
+    uint64_t ingest_ns[COUNT_INGEST_MODES];
+    for (Ingest_Mode mode = 0; mode < COUNT_INGEST_MODES; ++mode) {
+        start = bench_now_ns();
+        for (size_t frames = 0; frames < TOTAL_FRAMES; frames += BLOCK_FRAMES) {
+            ingest_frames(mode, block, BLOCK_FRAMES, CHANNELS, out);
+            for (size_t i = 0; i < ingest_streams(mode); ++i) ring_push(&rings[i], streams[i], BLOCK_FRAMES);
+        }
+        bench_sink = rings[0].items[FFT_SIZE/2];
+        ingest_ns[mode] = bench_now_ns() - start;
+    }
+
+    static const size_t factors[] = {2, 4};
+    uint64_t decimate_ns[sizeof(factors)/sizeof(factors[0])];
+    static Decimator decimator;
+    for (size_t f = 0; f < sizeof(factors)/sizeof(factors[0]); ++f) {
+        decimator_init(&decimator, factors[f]);
+        start = bench_now_ns();
+        for (size_t frames = 0; frames < TOTAL_FRAMES; frames += BLOCK_FRAMES) {
+            ingest_frames(INGEST_MONO, block, BLOCK_FRAMES, CHANNELS, out);
+            size_t kept = decimator_process(&decimator, streams[0], BLOCK_FRAMES, streams[0]);
+            ring_push(&rings[0], streams[0], kept);
+        }
+        bench_sink = rings[0].items[FFT_SIZE/2];
+        decimate_ns[f] = bench_now_ns() - start;
+    }
+    for (size_t i = 0; i < INGEST_STREAMS_MAX; ++i) ring_free(&rings[i]);
+
+    start = bench_now_ns();
+    size_t snapshots = TOTAL_FRAMES/735; // One per video frame at 60fps
+    for (size_t i = 0; i < snapshots; ++i) {
+        ring_snapshot(&ring, window, FFT_SIZE);
+    }
+    bench_sink = window[FFT_SIZE/2];
+    uint64_t snapshot_ns = bench_now_ns() - start;
+    ring_free(&ring);
+
+    // memmove and ring only ever took the left channel
+    bench_report("ingest", "memmove", "noise", FFT_SIZE, memmove_ns, TOTAL_FRAMES, 1, 0);
+    bench_report("ingest", "ring", "noise", FFT_SIZE, ring_ns, TOTAL_FRAMES, 1, 0);
+    for (Ingest_Mode mode = 0; mode < COUNT_INGEST_MODES; ++mode) {
+        bench_report("ingest", ingest_mode_name(mode), "noise", FFT_SIZE, ingest_ns[mode], TOTAL_FRAMES, CHANNELS, 0);
+    }
+    for (size_t f = 0; f < sizeof(factors)/sizeof(factors[0]); ++f) {
+        char name[32];
+        snprintf(name, sizeof(name), "decimate x%zu", factors[f]);
+        bench_report("ingest", name, "noise", FFT_SIZE, decimate_ns[f], TOTAL_FRAMES, CHANNELS, 0);
+    }
+    bench_report("ingest", "snapshot", "noise", FFT_SIZE, snapshot_ns, snapshots, FFT_SIZE, 0);
+    bench_close_results();
+    return 0;
+}
@@ -0,0 +1,168 @@
+// Checks and measures FFT_LOG_FAST of src/fft.h against logf() with every kernel this machine
+// supports.
+//
+//   $ cc -O2 -I. -o build/bench_log src_bench/log.c -lm
+//   $ ./build/bench_log [results.csv]
+//
+// or just `./nob bench`.
+//
+// Unlike the other benchmarks this one fails if the fast log is off by more than
+// FFT_LOG_FAST_MAX_ERROR nepers anywhere over the positive normal floats. It walks all of them
+// with a stride of ACCURACY_STRIDE bit patterns, which hits every exponent at many mantissas,
+// plus the powers of two and the neighbours of sqrt(2) where the range reduction switches over.
+// It also fails if the bars the analyzer normalizes out of the fast log are more than
+// 2*FFT_LOG_FAST_MAX_ERROR of the bar height off, see fft_squash_bands() in src/plug.c, or if
+// it takes longer than logf() with any of the kernels.
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FFT_IMPLEMENTATION
+#include "src/fft.h"
+#include "src_bench/bench.h"
+
+#define ACCURACY_STRIDE 61
+#define CHUNK 4096
+#define BARS 1024
+#define SPECTRA 4096
+#define TIMING_SIZE (1 << 20)
+#define TIMING_FRAMES 64
+
+static float in[CHUNK], fast[CHUNK];
+static size_t pending = 0;
+static double worst = 0.0;
+
+// Checks the pending inputs against logf()
+static void flush(void)
+{
+    fft_log(in, fast, pending, FFT_LOG_FAST);
+    for (size_t i = 0; i < pending; ++i) {
+        double d = fabs((double)fast[i] - (double)logf(in[i]));
+        if (d > worst) worst = d;
+    }
+    pending = 0;
+}
+
+static void check(float x)
+{
+    if (!(x >= FLT_MIN && x <= FLT_MAX)) return;
+    in[pending++] = x;
+    if (pending == CHUNK) flush();
+}
+
+// Max error of the fast log against logf() over the positive normal floats
+static double log_error(void)
+{
+    worst = 0.0;
+    for (uint64_t bits = 0x00800000; bits <= 0x7F7FFFFF; bits += ACCURACY_STRIDE) {
+        uint32_t b = (uint32_t)bits;
+        float x;
+        memcpy(&x, &b, sizeof(x));
+        check(x);
+    }
+    // The edges of the range reduction
+    for (int e = -126; e <= 127; ++e) {
+        float x = ldexpf(1.0f, e);
+        check(x);
+        check(nextafterf(x, 0.0f));
+        check(nextafterf(x, INFINITY));
+        check(nextafterf(x*FFT_LOG_SQRT2, 0.0f));
+        check(nextafterf(x*FFT_LOG_SQRT2, INFINITY));
+    }
+    flush();
+    return worst;
+}
+
+// The same normalization as fft_squash_bands() in src/plug.c
+static void normalize(float bars[], size_t m)
+{
+    float max_amp = 1.0f;
+    for (size_t i = 0; i < m; ++i) {
+        if (!(bars[i] > 0.0f)) bars[i] = 0.0f;
+        if (max_amp < bars[i]) max_amp = bars[i];
+    }
+    for (size_t i = 0; i < m; ++i) bars[i] /= max_amp;
+}
+
+// Max difference of the normalized bars between the fast and the exact log over spectra of
+// noise of all sorts of loudness
+static double bars_error(void)
+{
+    static float power[BARS], exact[BARS], approx[BARS];
+    uint32_t seed = 69;
+    double error = 0.0;
+    for (size_t s = 0; s < SPECTRA; ++s) {
+        // From way below the silence up to the loudest the FFT of a full scale sine can get
+        float loudness = 30.0f*bench_noise(&seed);
+        for (size_t i = 0; i < BARS; ++i) {
+            power[i] = expf(loudness + 10.0f*bench_noise(&seed));
+        }
+        fft_log(power, exact, BARS, FFT_LOG_EXACT);
+        fft_log(power, approx, BARS, FFT_LOG_FAST);
+        normalize(exact, BARS);
+        normalize(approx, BARS);
+        for (size_t i = 0; i < BARS; ++i) {
+            double d = fabs((double)exact[i] - (double)approx[i]);
+            if (d > error) error = d;
+        }
+    }
+    return error;
+}
+
+int main(int argc, char **argv)
+{
+    if (!bench_open_results(argc, argv)) return 1;
+
+    float *timing_in = malloc(TIMING_SIZE*sizeof(*timing_in));
+    float *timing_out = malloc(TIMING_SIZE*sizeof(*timing_out));
+    if (timing_in == NULL || timing_out == NULL) {
+        fprintf(stderr, "ERROR: could not allocate the buffers\n");
+        return 1;
+    }
+    uint32_t seed = 69;
+    for (size_t i = 0; i < TIMING_SIZE; ++i) timing_in[i] = expf(40.0f*bench_noise(&seed));
+
+    bool ok = true;
+    for (FFT_Kernels_Kind kind = 0; kind < COUNT_FFT_KERNELS; ++kind) {
+        if (!fft_kernels_select(kind)) continue;
+        const char *name = fft_kernels_name(kind);
+
+        double error = log_error();
+        double bars = bars_error();
+        printf("log      %-16s max error %.3g nepers, %.3g of the bar height\n", name, error, bars);
+        if (error > FFT_LOG_FAST_MAX_ERROR) {
+            fprintf(stderr, "ERROR: the fast log of the %s kernels is off by %g, more than %g\n", name, error, FFT_LOG_FAST_MAX_ERROR);
+            ok = false;
+        }
+        if (bars > 2.0*FFT_LOG_FAST_MAX_ERROR) {
+            fprintf(stderr, "ERROR: the bars of the %s kernels are off by %g, more than %g\n", name, bars, 2.0*FFT_LOG_FAST_MAX_ERROR);
+            ok = false;
+        }
+
+        uint64_t elapsed[COUNT_FFT_LOG_MODES];
+        for (FFT_Log_Mode mode = 0; mode < COUNT_FFT_LOG_MODES; ++mode) {
+            uint64_t start = bench_now_ns();
+            for (size_t frame = 0; frame < TIMING_FRAMES; ++frame) {
+                fft_log(timing_in, timing_out, TIMING_SIZE, mode);
+            }
+            elapsed[mode] = bench_now_ns() - start;
+            bench_sink = timing_out[TIMING_SIZE/2];
+            char case_name[32];
+            snprintf(case_name, sizeof(case_name), "%s %s", name, fft_log_mode_name(mode));
+            bench_report("log", case_name, "noise", TIMING_SIZE, elapsed[mode], TIMING_FRAMES, TIMING_SIZE, 0);
+        }
+        // The fast log is the default, it has no business being slower than logf(), the scalar
+        // one included: that's what the builds without SIMD get
+        if (elapsed[FFT_LOG_FAST] >= elapsed[FFT_LOG_EXACT]) {
+            fprintf(stderr, "ERROR: the fast log of the %s kernels is slower than logf()\n", name);
+            ok = false;
+        }
+    }
+
+    free(timing_in);
+    free(timing_out);
+    bench_close_results();
+    return ok ? 0 : 1;
+}
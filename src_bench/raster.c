@@ -0,0 +1,78 @@
+// Measures how long the software render backend takes to draw a video frame on one processor.
+//
+//   $ cc -O2 -I. -o build/bench_raster src_bench/raster.c -lm
+//   $ ./build/bench_raster [results.csv]
+//
+// or just `./nob bench`.
+//
+// Every case draws the spectrum of some noise over the whole 1920x1080 frame with raster.h like
+// the rendering of the videos does, one frame after another. "clear" is just the background.
+// The glow cases are the smears and the circles at the size of fft_glow_scale(): "glow 1" is
+// what the videos get, "glow 0.25" what the preview gets with the bloom. "lines" is without
+// them. The rendering splits the frame over all of the processors, so divide by their amount.
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PALETTE_IMPLEMENTATION
+#include "src/palette.h"
+#define RASTER_IMPLEMENTATION
+#include "src/raster.h"
+#include "src_bench/bench.h"
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define BARS 120
+#define FRAMES 60
+
+int main(int argc, char **argv)
+{
+    if (!bench_open_results(argc, argv)) return 1;
+
+    static float smooth[BARS], smear[BARS];
+    static Palette_Color colors[BARS];
+    uint32_t seed = 69;
+    for (size_t i = 0; i < BARS; ++i) {
+        smooth[i] = 0.5f + 0.5f*bench_noise(&seed);
+        smear[i] = 0.5f + 0.5f*bench_noise(&seed);
+        colors[i] = palette_sample(palette_builtin(0), (float)i/BARS);
+    }
+
+    Raster_Image image = {malloc(WIDTH*HEIGHT*4), WIDTH, HEIGHT};
+    if (image.pixels == NULL) {
+        fprintf(stderr, "ERROR: could not allocate the image\n");
+        return 1;
+    }
+    Palette_Color background = {0x15, 0x15, 0x15, 0xFF};
+
+    static const struct {
+        const char *name;
+        size_t m;
+        float glow_scale;
+    } cases[] = {
+        {"clear", 0, 0.0f},
+        {"lines", BARS, 0.0f},
+        {"glow 0.25", BARS, 0.25f},
+        {"glow 1", BARS, 1.0f},
+    };
+    for (size_t c = 0; c < sizeof(cases)/sizeof(cases[0]); ++c) {
+        Raster_Spectrum s = {
+            .m = cases[c].m,
+            .smooth = smooth,
+            .smear = smear,
+            .colors = colors,
+            .x = 0, .y = 0, .width = WIDTH, .height = HEIGHT,
+            .glow_scale = cases[c].glow_scale,
+        };
+        uint64_t start = bench_now_ns();
+        for (size_t frame = 0; frame < FRAMES; ++frame) {
+            raster_clear(&image, background, 0, HEIGHT);
+            raster_spectrum(&image, &s, 0, HEIGHT);
+        }
+        bench_sink = image.pixels[(HEIGHT/2*WIDTH + WIDTH/2)*4];
+        bench_report("raster", cases[c].name, "noise", cases[c].m, bench_now_ns() - start, FRAMES, WIDTH*HEIGHT, 0);
+    }
+
+    free(image.pixels);
+    bench_close_results();
+    return 0;
+}
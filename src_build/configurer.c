@@ -76,6 +76,26 @@ static Feature_Flag feature_flags[] = {
         .macro = "MUSIALIZER_ACT_ON_PRESS",
         .description = "Activate UI buttons on Press instead of Release just as John Carmack explained https://twitter.com/ID_AA_Carmack/status/1787850053912064005"
     },
+    {
+        .display = "Force Scalar FFT",
+        .macro = "MUSIALIZER_FFT_FORCE_SCALAR",
+        .description = "Use the scalar FFT kernels instead of picking the fastest ones for the CPU at startup. Useful for benchmarking. Enable at most one of the FFT_FORCE flags.",
+    },
+    {
+        .display = "Force SSE2 FFT",
+        .macro = "MUSIALIZER_FFT_FORCE_SSE2",
+        .description = "Use the SSE2 FFT kernels (x86_64 only) instead of picking the fastest ones for the CPU at startup.",
+    },
+    {
+        .display = "Force AVX2 FFT",
+        .macro = "MUSIALIZER_FFT_FORCE_AVX2",
+        .description = "Use the AVX2 FFT kernels (x86_64 only) instead of picking the fastest ones for the CPU at startup.",
+    },
+    {
+        .display = "Force NEON FFT",
+        .macro = "MUSIALIZER_FFT_FORCE_NEON",
+        .description = "Use the NEON FFT kernels (aarch64 only) instead of picking the fastest ones for the CPU at startup.",
+    },
 };
 
 #define genf(out, ...) \
@@ -14,7 +14,7 @@ bool build_musializer(void)
         "-I.", "-I./raylib/raylib-"RAYLIB_VERSION"/src/",
         "-fPIC", "-shared",
         "-o", "./build/libplug.so",
-        "./src/plug.c", "./src/ffmpeg_linux.c",
+        "./src/plug.c", "./src/ffmpeg_linux.c", "./src/thread_posix.c", "./src/mapped_file_posix.c",
         nob_temp_sprintf("-L./build/raylib/%s", MUSIALIZER_TARGET_NAME), "-l:libraylib.so",
         "-lm", "-ldl", "-lpthread");
     nob_da_append(&procs, nob_cmd_run_async_and_reset(&cmd));
@@ -39,7 +39,7 @@ bool build_musializer(void)
         "-I.",
         "-I./raylib/raylib-"RAYLIB_VERSION"/src/",
         "-o", "./build/musializer",
-        "./src/plug.c", "./src/ffmpeg_linux.c", "./src/main.c",
+        "./src/plug.c", "./src/ffmpeg_linux.c", "./src/thread_posix.c", "./src/mapped_file_posix.c", "./src/main.c",
         nob_temp_sprintf("-L./build/raylib/%s", MUSIALIZER_TARGET_NAME), "-l:libraylib.a",
         "-lm", "-ldl", "-lpthread");
     if (!nob_cmd_run_sync_and_reset(&cmd)) nob_return_defer(false);
@@ -136,3 +136,15 @@ bool build_dist() {
     return true;
 #endif // MUSIALIZER_HOTRELOAD
 }
+
+const char *build_bench(const char *name) {
+    const char *exe_path = nob_temp_sprintf("./build/bench_%s", name);
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-I.");
+    nob_cmd_append(&cmd, "-o", exe_path);
+    nob_cmd_append(&cmd, nob_temp_sprintf("./src_bench/%s.c", name));
+    nob_cmd_append(&cmd, "-lm");
+    bool ok = nob_cmd_run_sync(cmd);
+    nob_cmd_free(cmd);
+    return ok ? exe_path : NULL;
+}
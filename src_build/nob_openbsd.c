@@ -18,7 +18,9 @@ bool build_musializer(void) {
                 nob_cmd_append(&cmd, "-o", "./build/libplug.so");
                 nob_cmd_append(&cmd,
                     "./src/plug.c",
-                    "./src/ffmpeg_linux.c");
+                    "./src/ffmpeg_linux.c",
+                    "./src/thread_posix.c",
+                    "./src/mapped_file_posix.c");
                 nob_cmd_append(&cmd,
                     nob_temp_sprintf("-L./build/raylib/%s", MUSIALIZER_TARGET_NAME),
                     "-l:libraylib.so");
@@ -56,6 +58,8 @@ bool build_musializer(void) {
             nob_cmd_append(&cmd,
                 "./src/plug.c",
                 "./src/ffmpeg_linux.c",
+                "./src/thread_posix.c",
+                "./src/mapped_file_posix.c",
                 "./src/musializer.c");
             nob_cmd_append(&cmd,
                 nob_temp_sprintf("-L./build/raylib/%s", MUSIALIZER_TARGET_NAME),
@@ -161,3 +165,15 @@ bool build_dist() {
     return true;
 #endif // MUSIALIZER_HOTRELOAD
 }
+
+const char *build_bench(const char *name) {
+    const char *exe_path = nob_temp_sprintf("./build/bench_%s", name);
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, "cc", "-Wall", "-Wextra", "-O2", "-I.");
+    nob_cmd_append(&cmd, "-o", exe_path);
+    nob_cmd_append(&cmd, nob_temp_sprintf("./src_bench/%s.c", name));
+    nob_cmd_append(&cmd, "-lm");
+    bool ok = nob_cmd_run_sync(cmd);
+    nob_cmd_free(cmd);
+    return ok ? exe_path : NULL;
+}
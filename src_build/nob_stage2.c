@@ -43,9 +43,42 @@ void log_available_subcommands(const char *program, Nob_Log_Level level) {
     nob_log(level, "    build (default)");
     nob_log(level, "    dist");
     nob_log(level, "    svg");
+    nob_log(level, "    bench");
     nob_log(level, "    help");
 }
 
+// The microbenchmarks in ./src_bench/. Every one of them appends its results to
+// BENCH_RESULTS_PATH as CSV rows, see ./src_bench/bench.h.
+static const char *benches[] = {
+    "ingest",
+    "analyzer",
+    "log",
+    "raster",
+};
+
+#define BENCH_RESULTS_PATH "./build/bench.csv"
+
+bool run_benches(void) {
+    if (!nob_mkdir_if_not_exists("./build/")) return false;
+    // Start from an empty file so the header only gets written once
+    if (!nob_write_entire_file(BENCH_RESULTS_PATH, "", 0)) return false;
+
+    bool result = true;
+    Nob_Cmd cmd = {0};
+    for (size_t i = 0; i < NOB_ARRAY_LEN(benches); ++i) {
+        const char *exe_path = build_bench(benches[i]);
+        if (exe_path == NULL) nob_return_defer(false);
+        cmd.count = 0;
+        nob_cmd_append(&cmd, exe_path, BENCH_RESULTS_PATH);
+        if (!nob_cmd_run_sync(cmd)) nob_return_defer(false);
+    }
+    nob_log(NOB_INFO, "Saved the results to %s", BENCH_RESULTS_PATH);
+
+defer:
+    nob_cmd_free(cmd);
+    return result;
+}
+
 typedef struct {
     const char *file_path;
     size_t offset;
@@ -55,6 +88,10 @@ typedef struct {
 Resource resources[] = {
     { .file_path = "./resources/logo/logo-256.png" },
     { .file_path = "./resources/shaders/circle.fs" },
+    { .file_path = "./resources/shaders/bars.vs" },
+    { .file_path = "./resources/shaders/spectrum.fs" },
+    { .file_path = "./resources/shaders/bloom_down.fs" },
+    { .file_path = "./resources/shaders/bloom_up.fs" },
     { .file_path = "./resources/icons/volume.png" },
     { .file_path = "./resources/icons/play.png" },
     { .file_path = "./resources/icons/render.png" },
@@ -190,6 +227,8 @@ int main(int argc, char **argv) {
         }
 
         if (!nob_procs_wait(procs)) return 1;
+    } else if (strcmp(subcommand, "bench") == 0) {
+        if (!run_benches()) return 1;
     } else if (strcmp(subcommand, "help") == 0) {
         log_available_subcommands(program, NOB_INFO);
     } else {
@@ -30,7 +30,9 @@ bool build_musializer(void) {
         nob_cmd_append(&cmd, "-o", "./build/libplug.dll");
         nob_cmd_append(&cmd,
                         "./src/plug.c",
-                        "./src/ffmpeg_windows.c");
+                        "./src/ffmpeg_windows.c",
+                        "./src/thread_windows.c",
+                        "./src/mapped_file_windows.c");
         nob_cmd_append(&cmd,
                         "-L./build",
                         "-l:raylib.dll");
@@ -68,6 +70,8 @@ bool build_musializer(void) {
         nob_cmd_append(&cmd, "-o", "./build/musializer");
         nob_cmd_append(&cmd, "./src/plug.c",
                             "./src/ffmpeg_windows.c",
+                            "./src/thread_windows.c",
+                            "./src/mapped_file_windows.c",
                             "./src/main.c",
                             "./build/musializer.res");
         nob_cmd_append(&cmd, nob_temp_sprintf("-L./build/raylib/%s", MUSIALIZER_TARGET_NAME), "-l:libraylib.a");
@@ -176,4 +180,16 @@ bool build_dist(void) {
     nob_log(NOB_INFO, "Created %s", dist_path);
     return true;
 #endif // MUSIALIZER_HOTRELOAD
-}
\ No newline at end of file
+}
+
+const char *build_bench(const char *name) {
+    const char *exe_path = nob_temp_sprintf("./build/bench_%s.exe", name);
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, "x86_64-w64-mingw32-gcc", "-Wall", "-Wextra", "-O2", "-I.");
+    nob_cmd_append(&cmd, "-o", exe_path);
+    nob_cmd_append(&cmd, nob_temp_sprintf("./src_bench/%s.c", name));
+    nob_cmd_append(&cmd, "-lm");
+    bool ok = nob_cmd_run_sync(cmd);
+    nob_cmd_free(cmd);
+    return ok ? exe_path : NULL;
+}
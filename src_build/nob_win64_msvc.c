@@ -22,7 +22,9 @@ bool build_musializer(void) {
             nob_cmd_append(&cmd, "/I", "./raylib/raylib-"RAYLIB_VERSION"/src/");
             nob_cmd_append(&cmd,
                 "src/plug.c",
-                "src/ffmpeg_windows.c");
+                "src/ffmpeg_windows.c",
+                "src/thread_windows.c",
+                "src/mapped_file_windows.c");
             nob_cmd_append(&cmd,
                 "/link",
                 nob_temp_sprintf("/LIBPATH:build/raylib/%s", MUSIALIZER_TARGET_NAME),
@@ -58,7 +60,9 @@ bool build_musializer(void) {
         nob_cmd_append(&cmd,
             "./src/main.c",
             "./src/plug.c",
-            "./src/ffmpeg_windows.c"
+            "./src/ffmpeg_windows.c",
+            "./src/thread_windows.c",
+            "./src/mapped_file_windows.c"
             );
         nob_cmd_append(&cmd,
             "/link",
@@ -155,4 +159,16 @@ bool build_dist(void) {
     nob_log(NOB_ERROR, "TODO: Creating distro for MSVC build is not implemented yet");
     return false;
 #endif // MUSIALIZER_HOTRELOAD
-}
\ No newline at end of file
+}
+
+const char *build_bench(const char *name) {
+    const char *exe_path = nob_temp_sprintf("build\\bench_%s.exe", name);
+    Nob_Cmd cmd = {0};
+    nob_cmd_append(&cmd, "cl.exe", "/O2");
+    nob_cmd_append(&cmd, "/I", "./");
+    nob_cmd_append(&cmd, "/Fobuild\\", nob_temp_sprintf("/Fe%s", exe_path));
+    nob_cmd_append(&cmd, nob_temp_sprintf("./src_bench/%s.c", name));
+    bool ok = nob_cmd_run_sync(cmd);
+    nob_cmd_free(cmd);
+    return ok ? exe_path : NULL;
+}